@@ -0,0 +1,661 @@
+//
+//  microbench.cpp
+//  microbench
+//
+//  Microbenchmarks for the loaders and per-frame CPU helpers, built next to the opengl2 target
+//  so every change to them comes with a number. GL calls go to NullGL, which keeps GPU and
+//  driver time out of the measurements; what is left is our own CPU work plus NullGL's
+//  validation and buffer copies.
+//
+//  Run from the opengl2 directory, or build with MICROBENCH_ASSET_DIR pointing at it:
+//      microbench --benchmark_filter=ProcessMesh
+//
+#include <glad/glad.h>
+#include <benchmark/benchmark.h>
+#include "stb_image.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GLExtensions.h"
+#include "NullGL.h"
+#include "Shader.h"
+#include "ShaderCache.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "JobSystem.h"
+#include "DrawList.h"
+#include "FrameRing.h"
+#include "UniformBlocks.h"
+#include "Hud.h"
+#include "Profiler.h"
+
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef MICROBENCH_ASSET_DIR
+#define MICROBENCH_ASSET_DIR "."
+#endif
+
+// sample images shipped with the project, indexed by the TextureFromFile / stbi_load benchmarks
+static const char *sampleImages[] = { "container.jpg", "container2.png", "container2_specular.png", "matrix.jpg", "awesomeface.png" };
+
+struct ModelMicrobench
+{
+    static Model emptyModel()
+    {
+        return Model();
+    }
+
+    static Mesh processMesh(Model &model, aiMesh *mesh, const aiScene *scene)
+    {
+        return model.processMesh(mesh, scene);
+    }
+
+    // loadModel after the import: conversion on the job system, then the GL buffers
+    static void processScene(Model &model, const aiScene *scene)
+    {
+        model.processScene(scene);
+    }
+};
+
+// square grid of roughly `triangles` triangles with every attribute processMesh reads
+static aiMesh* makeGridMesh(int64_t triangles)
+{
+    unsigned int cells = (unsigned int)std::ceil(std::sqrt(triangles / 2.0));
+    unsigned int side = cells + 1;
+
+    aiMesh *mesh = new aiMesh();
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mNumVertices = side * side;
+    mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+    mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+    mesh->mTangents = new aiVector3D[mesh->mNumVertices];
+    mesh->mBitangents = new aiVector3D[mesh->mNumVertices];
+    mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+    for (unsigned int y = 0; y < side; y++)
+    {
+        for (unsigned int x = 0; x < side; x++)
+        {
+            unsigned int v = y * side + x;
+            mesh->mVertices[v] = aiVector3D((float)x, 0.0f, (float)y);
+            mesh->mNormals[v] = aiVector3D(0.0f, 1.0f, 0.0f);
+            mesh->mTangents[v] = aiVector3D(1.0f, 0.0f, 0.0f);
+            mesh->mBitangents[v] = aiVector3D(0.0f, 0.0f, 1.0f);
+            mesh->mTextureCoords[0][v] = aiVector3D((float)x / cells, (float)y / cells, 0.0f);
+        }
+    }
+
+    mesh->mNumFaces = cells * cells * 2;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    unsigned int f = 0;
+    for (unsigned int y = 0; y < cells; y++)
+    {
+        for (unsigned int x = 0; x < cells; x++)
+        {
+            unsigned int v = y * side + x;
+            unsigned int quad[2][3] = { { v, v + side, v + 1 }, { v + 1, v + side, v + side + 1 } };
+            for (auto &triangle : quad)
+            {
+                aiFace &face = mesh->mFaces[f++];
+                face.mNumIndices = 3;
+                face.mIndices = new unsigned int[3] { triangle[0], triangle[1], triangle[2] };
+            }
+        }
+    }
+
+    return mesh;
+}
+
+// meshCount grids of roughly `triangles` triangles each under the root node, plus an empty
+// material so the texture lookups run but find nothing. The scene owns meshes, nodes and material.
+static aiScene* makeGridScene(int64_t triangles, unsigned int meshCount = 1)
+{
+    aiScene *scene = new aiScene();
+    scene->mNumMeshes = meshCount;
+    scene->mMeshes = new aiMesh*[meshCount];
+    scene->mRootNode = new aiNode();
+    scene->mRootNode->mNumMeshes = meshCount;
+    scene->mRootNode->mMeshes = new unsigned int[meshCount];
+    for (unsigned int i = 0; i < meshCount; i++)
+    {
+        scene->mMeshes[i] = makeGridMesh(triangles);
+        scene->mRootNode->mMeshes[i] = i;
+    }
+    scene->mNumMaterials = 1;
+    scene->mMaterials = new aiMaterial*[1] { new aiMaterial() };
+    return scene;
+}
+
+// Model::processMesh, including setupMesh's buffer uploads
+// ------------------------------------------------------------------------
+static void BM_ProcessMesh(benchmark::State &state)
+{
+    aiScene *scene = makeGridScene(state.range(0));
+    aiMesh *mesh = scene->mMeshes[0];
+    Model model = ModelMicrobench::emptyModel();
+    for (auto _ : state)
+    {
+        Mesh result = ModelMicrobench::processMesh(model, mesh, scene);
+        benchmark::DoNotOptimize(result.vertices.data());
+        result.release();
+    }
+    state.SetItemsProcessed(state.iterations() * mesh->mNumFaces);
+    state.counters["vertices"] = mesh->mNumVertices;
+    delete scene;
+}
+BENCHMARK(BM_ProcessMesh)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+
+// TextureFromFile: decode, upload and mipmap generation (the last two are near free on NullGL)
+// ------------------------------------------------------------------------
+static void BM_TextureFromFile(benchmark::State &state)
+{
+    const char *image = sampleImages[state.range(0)];
+    state.SetLabel(image);
+    for (auto _ : state)
+    {
+        unsigned int texture = TextureFromFile(image, MICROBENCH_ASSET_DIR);
+        glDeleteTextures(1, &texture);
+    }
+}
+BENCHMARK(BM_TextureFromFile)->DenseRange(0, 4)->Unit(benchmark::kMillisecond);
+
+// decode alone, to separate stb_image from the GL side of TextureFromFile
+// ------------------------------------------------------------------------
+static void BM_StbiLoad(benchmark::State &state)
+{
+    const char *image = sampleImages[state.range(0)];
+    std::string path = std::string(MICROBENCH_ASSET_DIR) + '/' + image;
+    state.SetLabel(image);
+    int64_t bytes = 0;
+    for (auto _ : state)
+    {
+        int width, height, components;
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if (!data)
+        {
+            state.SkipWithError("stbi_load failed");
+            break;
+        }
+        bytes += (int64_t)width * height * components;
+        stbi_image_free(data);
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_StbiLoad)->DenseRange(0, 4)->Unit(benchmark::kMillisecond);
+
+// camera
+// ------------------------------------------------------------------------
+static void BM_CameraGetViewMatrix(benchmark::State &state)
+{
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    for (auto _ : state)
+    {
+        glm::mat4 view = camera.GetViewMatrix();
+        benchmark::DoNotOptimize(view);
+        camera.Position.x += 1e-6f;
+    }
+}
+BENCHMARK(BM_CameraGetViewMatrix);
+
+static void BM_CameraMyLookAt(benchmark::State &state)
+{
+    Camera camera;
+    glm::vec3 position(0.0f, 0.0f, 3.0f);
+    glm::vec3 target(0.0f);
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(position);
+        glm::mat4 view = camera.my_look_at(position, target, up);
+        benchmark::DoNotOptimize(view);
+    }
+}
+BENCHMARK(BM_CameraMyLookAt);
+
+// reference point for my_look_at
+static void BM_GlmLookAt(benchmark::State &state)
+{
+    glm::vec3 position(0.0f, 0.0f, 3.0f);
+    glm::vec3 target(0.0f);
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(position);
+        glm::mat4 view = glm::lookAt(position, target, up);
+        benchmark::DoNotOptimize(view);
+    }
+}
+BENCHMARK(BM_GlmLookAt);
+
+static void BM_CameraProcessMouseMovement(benchmark::State &state)
+{
+    Camera camera;
+    float direction = 1.0f;
+    for (auto _ : state)
+    {
+        camera.ProcessMouseMovement(3.0f * direction, 2.0f * direction);
+        direction = -direction;
+        benchmark::DoNotOptimize(camera.Front);
+    }
+}
+BENCHMARK(BM_CameraProcessMouseMovement);
+
+// Shader uniform setters, each one a location lookup plus an upload against NullGL, on the plain
+// uniforms the uniform blocks left: the cube material and the HUD's screen size
+// ------------------------------------------------------------------------
+static Shader& benchShader()
+{
+    static Shader shader((std::string(MICROBENCH_ASSET_DIR) + "/cube_v_shader").c_str(),
+                         (std::string(MICROBENCH_ASSET_DIR) + "/cube_f_shader").c_str());
+    return shader;
+}
+
+static Shader& benchHudShader()
+{
+    static Shader shader((std::string(MICROBENCH_ASSET_DIR) + "/hud_v").c_str(),
+                         (std::string(MICROBENCH_ASSET_DIR) + "/hud_f").c_str());
+    return shader;
+}
+
+static void BM_ShaderSetInt(benchmark::State &state)
+{
+    Shader &shader = benchShader();
+    shader.use();
+    for (auto _ : state)
+        shader.setInt("material.diffuse", 0);
+}
+BENCHMARK(BM_ShaderSetInt);
+
+static void BM_ShaderSetFloat(benchmark::State &state)
+{
+    Shader &shader = benchShader();
+    shader.use();
+    for (auto _ : state)
+        shader.setFloat("material.shininess", 32.0f);
+}
+BENCHMARK(BM_ShaderSetFloat);
+
+static void BM_ShaderSetVec2(benchmark::State &state)
+{
+    Shader &shader = benchHudShader();
+    shader.use();
+    for (auto _ : state)
+        shader.setVec2("screenSize", 1280.0f, 720.0f);
+}
+BENCHMARK(BM_ShaderSetVec2);
+
+// uniform block writes into a FrameRing, the way the frame loop does them. range(0) is 1 for the
+// mapped ring and 0 for the unmapped one --capture uses, which uploads with glBufferSubData
+// ------------------------------------------------------------------------
+static std::vector<DrawCommand> benchDrawCommands()
+{
+    std::vector<DrawCommand> draws(4096);
+    for (size_t i = 0; i < draws.size(); i++)
+    {
+        draws[i].model = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0.0f, 0.0f));
+        draws[i].bakedAmbient = glm::vec3(0.1f);
+        draws[i].lightingLod = (int)(i % 3);
+        draws[i].nearestPointLight = (int)(i % 4);
+    }
+    return draws;
+}
+
+// Camera and Lights with every point light, written and bound once per frame
+static void BM_FrameBlocksCameraLights(benchmark::State &state)
+{
+    std::vector<PointLight> pointLights(MAX_POINT_LIGHTS);
+    for (size_t i = 0; i < pointLights.size(); i++)
+        pointLights[i].position = glm::vec3((float)i, 1.0f, 0.0f);
+    FrameRing ring;
+    ring.init(sizeof(CameraBlock) + sizeof(LightsBlock) + 1024, 3, state.range(0) != 0);
+    for (auto _ : state)
+    {
+        FrameBlocks blocks = FrameBlocks::begin(ring, 0);
+        CameraBlock camera = {};
+        camera.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        camera.projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        camera.viewPos = glm::vec3(0.0f, 0.0f, 3.0f);
+        blocks.camera.write(0, camera);
+        LightsBlock lights = {};
+        lights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+        lights.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+        lights.setPointLights(pointLights);
+        blocks.lights.write(0, lights);
+        ring.commit();
+        blocks.bindFrame();
+        ring.endFrame();
+    }
+    ring.release();
+}
+BENCHMARK(BM_FrameBlocksCameraLights)->Arg(1)->Arg(0);
+
+// per-draw uniforms of 4096 draws: a memcpy per draw into the frame ring, then the range bind of
+// each draw
+static void BM_DrawUniformsFrameRing(benchmark::State &state)
+{
+    std::vector<DrawCommand> draws = benchDrawCommands();
+    FrameRing ring;
+    ring.init(draws.size() * 256, 3, state.range(0) != 0);
+    for (auto _ : state)
+    {
+        FrameBlocks blocks = FrameBlocks::begin(ring, draws.size());
+        for (size_t i = 0; i < draws.size(); i++)
+        {
+            DrawBlock block = {};
+            block.model = draws[i].model;
+            block.bakedAmbient = draws[i].bakedAmbient;
+            block.lightingLod = draws[i].lightingLod;
+            block.nearestPointLight = draws[i].nearestPointLight;
+            blocks.writeDraw(i, block);
+        }
+        ring.commit();
+        for (size_t i = 0; i < draws.size(); i++)
+            blocks.bindDraw(i);
+        ring.endFrame();
+    }
+    ring.release();
+    state.SetItemsProcessed(state.iterations() * draws.size());
+}
+BENCHMARK(BM_DrawUniformsFrameRing)->Arg(1)->Arg(0)->Unit(benchmark::kMicrosecond);
+
+// Mesh copies and moves, as vector<Mesh> growth and Model::meshes.push_back do them
+// ------------------------------------------------------------------------
+static Mesh makeMesh(int64_t vertexCount)
+{
+    vector<Vertex> vertices(vertexCount);
+    vector<unsigned int> indices(vertexCount);
+    for (int64_t i = 0; i < vertexCount; i++)
+    {
+        vertices[i].Position = glm::vec3((float)i, 0.0f, 0.0f);
+        indices[i] = (unsigned int)i;
+    }
+    vector<Texture> textures(2);
+    return Mesh(vertices, indices, textures);
+}
+
+static void BM_MeshCopy(benchmark::State &state)
+{
+    Mesh source = makeMesh(state.range(0));
+    for (auto _ : state)
+    {
+        Mesh copy(source);
+        benchmark::DoNotOptimize(copy.vertices.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * (sizeof(Vertex) + sizeof(unsigned int) + sizeof(glm::vec3)));
+    source.release();
+}
+BENCHMARK(BM_MeshCopy)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// two moves per iteration, so the source is valid again for the next one
+static void BM_MeshMove(benchmark::State &state)
+{
+    Mesh source = makeMesh(state.range(0));
+    for (auto _ : state)
+    {
+        Mesh moved(std::move(source));
+        benchmark::DoNotOptimize(moved.vertices.data());
+        source = std::move(moved);
+    }
+    source.release();
+}
+BENCHMARK(BM_MeshMove)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// job system scaling: each benchmark runs once per thread count from 1 to the number of cores.
+// Wall clock time, the main thread's CPU time says nothing about the workers.
+// ------------------------------------------------------------------------
+static void useThreads(unsigned threads)
+{
+    JobSystem &jobs = JobSystem::get();
+    if (!jobs.isRunning() || jobs.threadCount() != threads)
+        jobs.init(threads);
+}
+
+static void threadCounts(benchmark::internal::Benchmark *benchmark)
+{
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= cores; threads *= 2)
+        benchmark->Arg(threads);
+    if ((cores & (cores - 1)) != 0)
+        benchmark->Arg(cores);
+}
+
+// transform update: a model matrix per object from its position and rotation
+static void BM_JobsParallelForTransforms(benchmark::State &state)
+{
+    useThreads((unsigned)state.range(0));
+    const size_t objects = 1 << 18;
+    std::vector<glm::vec3> positions(objects);
+    std::vector<float> angles(objects);
+    std::vector<glm::mat4> models(objects);
+    for (size_t i = 0; i < objects; i++)
+    {
+        positions[i] = glm::vec3((float)(i % 512), 0.0f, (float)(i / 512));
+        angles[i] = (float)i * 0.01f;
+    }
+    for (auto _ : state)
+    {
+        JobSystem::get().parallelFor(objects, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                models[i] = glm::rotate(glm::translate(glm::mat4(1.0f), positions[i]), angles[i], glm::vec3(0.0f, 1.0f, 0.0f));
+        });
+        benchmark::DoNotOptimize(models.data());
+    }
+    state.SetItemsProcessed(state.iterations() * objects);
+}
+BENCHMARK(BM_JobsParallelForTransforms)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// per-job overhead: submit, steal and finish jobs that do nothing
+static void BM_JobsEmpty(benchmark::State &state)
+{
+    useThreads((unsigned)state.range(0));
+    const int jobs = 10000;
+    for (auto _ : state)
+    {
+        JobCounter counter;
+        for (int i = 0; i < jobs; i++)
+            JobSystem::get().run([] {}, &counter);
+        JobSystem::get().wait(counter);
+    }
+    state.SetItemsProcessed(state.iterations() * jobs);
+}
+BENCHMARK(BM_JobsEmpty)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// uneven work: every 64th job is 100x heavier, stealing has to spread the heavy ones out
+static void BM_JobsUneven(benchmark::State &state)
+{
+    useThreads((unsigned)state.range(0));
+    const size_t items = 4096;
+    std::atomic<uint64_t> checksum{0};
+    for (auto _ : state)
+    {
+        JobSystem::get().parallelFor(items, [&](size_t begin, size_t end) {
+            uint64_t sum = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                int rounds = i % 64 == 0 ? 20000 : 200;
+                uint64_t x = i + 1;
+                for (int r = 0; r < rounds; r++)
+                    x = x * 6364136223846793005ull + 1442695040888963407ull;
+                sum += x;
+            }
+            checksum += sum;
+        }, 16);
+    }
+    benchmark::DoNotOptimize(checksum.load());
+    state.SetItemsProcessed(state.iterations() * items);
+}
+BENCHMARK(BM_JobsUneven)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// two dependent stages of 256 jobs each: the second stage reads what the first wrote. Chained
+// parks the second stage on the first stage's counter and waits once; waited blocks the caller
+// between the stages. Both check the order and fail the run if a second-stage job ran early.
+static void jobStages(benchmark::State &state, bool chained)
+{
+    useThreads((unsigned)state.range(0));
+    const size_t jobs = 256;
+    const size_t items = 1024;
+    std::vector<uint64_t> first(jobs * items);
+    std::vector<uint64_t> second(jobs);
+    std::atomic<int> early{0};
+    for (auto _ : state)
+    {
+        JobCounter firstDone;
+        JobCounter secondDone;
+        for (size_t job = 0; job < jobs; job++)
+            JobSystem::get().run([&, job] {
+                for (size_t i = 0; i < items; i++)
+                    first[job * items + i] = (job * items + i) * 6364136223846793005ull + 1;
+            }, &firstDone);
+        if (!chained)
+            JobSystem::get().wait(firstDone);
+        for (size_t job = 0; job < jobs; job++)
+            JobSystem::get().run([&, job] {
+                // reads the other end of the first stage, written by some other job
+                size_t source = jobs - 1 - job;
+                uint64_t sum = 0;
+                for (size_t i = 0; i < items; i++)
+                    sum += first[source * items + i];
+                if (first[source * items + items - 1] == 0)
+                    early++;
+                second[job] = sum;
+            }, &secondDone, chained ? &firstDone : nullptr);
+        JobSystem::get().wait(secondDone);
+        benchmark::DoNotOptimize(second.data());
+        std::fill(first.begin(), first.end(), 0);
+    }
+    if (early.load())
+        state.SkipWithError("second stage ran before the first finished");
+    state.SetItemsProcessed(state.iterations() * jobs * 2);
+}
+
+static void BM_JobsChainedStages(benchmark::State &state)
+{
+    jobStages(state, true);
+}
+BENCHMARK(BM_JobsChainedStages)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+static void BM_JobsWaitedStages(benchmark::State &state)
+{
+    jobStages(state, false);
+}
+BENCHMARK(BM_JobsWaitedStages)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// model conversion of 32 meshes of 50K triangles each, across meshes and vertex ranges,
+// including the serialized buffer creation
+static void BM_JobsProcessScene(benchmark::State &state)
+{
+    useThreads((unsigned)state.range(0));
+    const unsigned int meshCount = 32;
+    aiScene *scene = makeGridScene(50000, meshCount);
+    for (auto _ : state)
+    {
+        Model model = ModelMicrobench::emptyModel();
+        ModelMicrobench::processScene(model, scene);
+        benchmark::DoNotOptimize(model.meshes.data());
+        for (Mesh &mesh : model.meshes)
+            mesh.release();
+    }
+    state.SetItemsProcessed(state.iterations() * meshCount * scene->mMeshes[0]->mNumFaces);
+    delete scene;
+}
+BENCHMARK(BM_JobsProcessScene)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// draw recording for 256K cubes spread around the camera: culling, lighting level and its
+// uniforms, sort keys, then the merge and sort of the per-thread lists
+static void BM_JobsRecordDraws(benchmark::State &state)
+{
+    useThreads((unsigned)state.range(0));
+    const size_t objects = 1 << 18;
+    std::vector<glm::vec3> cubes(objects);
+    for (size_t i = 0; i < objects; i++)
+        cubes[i] = glm::vec3((float)(i % 512) * 0.4f - 102.4f, (float)(i % 7) - 3.0f, (float)(i / 512) * 0.4f - 102.4f);
+    std::vector<int> cubeLod(objects, LOD_FULL);
+    std::vector<glm::mat4> models;
+    std::vector<int> modelLod;
+    std::vector<PointLight> lights(MAX_POINT_LIGHTS);
+    for (size_t i = 0; i < lights.size(); i++)
+        lights[i] = { glm::vec3((float)i * 6.0f - 96.0f, 1.0f, 0.0f), 1.0f, 0.09f, 0.032f, glm::vec3(0.05f), glm::vec3(0.8f), glm::vec3(1.0f) };
+    LodSelector lodSelector;
+    DrawList::View view = { glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, -3.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+                            glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f), 600.0f, 100.0f, &lodSelector, &lights };
+    DrawList drawList;
+    for (auto _ : state)
+    {
+        drawList.record(view, cubes, 0.866f, cubeLod, models, glm::vec3(0.0f), 1.0f, modelLod);
+        benchmark::DoNotOptimize(drawList.sorted().data());
+    }
+    state.counters["visible"] = (double)drawList.sorted().size();
+    state.SetItemsProcessed(state.iterations() * objects);
+}
+BENCHMARK(BM_JobsRecordDraws)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// HUD draw after a session of range(0) frames with the profiler on. "depth prepass" ran once and
+// then stopped, like a Z-prepass switched off, so its lookup finds only a stale span. Pass times
+// come from the profiler's per-name latest spans: the cost has to stay flat however long the
+// session ran. Showing the HUD installs GLCounters as in the app, so this is registered last.
+// ------------------------------------------------------------------------
+static Hud& benchHud()
+{
+    static Hud hud;
+    if (!hud.isVisible())
+    {
+        // hud_v and hud_f are loaded relative to the working directory, like in the app
+        std::error_code ec;
+        std::filesystem::current_path(MICROBENCH_ASSET_DIR, ec);
+        hud.init();
+        hud.passes = { "depth prepass", "ground", "cubes", "backpack" };
+        hud.toggle();
+        { GpuProfileScope scope("depth prepass"); }
+        Profiler::get().endFrame();
+    }
+    return hud;
+}
+
+static void BM_HudDraw(benchmark::State &state)
+{
+    Hud &hud = benchHud();
+    static int64_t sessionFrames = 0;
+    for (; sessionFrames < state.range(0); sessionFrames++)
+    {
+        for (const char *pass : { "ground", "cubes", "backpack" })
+        {
+            GpuProfileScope scope(pass);
+        }
+        Profiler::get().endFrame();
+        hud.addFrame(16.0f, 4.0f);
+    }
+    for (auto _ : state)
+        hud.draw(1280, 720);
+    state.counters["session_frames"] = (double)sessionFrames;
+}
+BENCHMARK(BM_HudDraw)->Arg(0)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    if (!gladLoadGLLoader(&NullGL::loader))
+    {
+        std::cout << "ERROR::MICROBENCH::GL_LOAD_FAILED" << std::endl;
+        return -1;
+    }
+    loadGLExtensions(&NullGL::loader);
+    // plain programs and no disk cache, so the setters measure the common path every run
+    ShaderCache::directory().clear();
+    Shader::useSeparablePrograms() = false;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    JobSystem::get().shutdown();
+    if (NullGL::errorCount())
+        std::cout << "ERROR::MICROBENCH::NULL_GL_ERRORS " << NullGL::errorCount() << std::endl;
+    return 0;
+}
@@ -0,0 +1,222 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+// Offscreen benchmark run (--bench): renders a fixed number of frames into an FBO along a fixed
+// camera path and reports frame time percentiles as JSON.
+//
+// Every frame ends with glFinish, so a frame's time is its CPU submit time plus whatever the GPU
+// still had to do afterwards. That costs the CPU/GPU overlap a swap chain would give, but makes
+// each sample independent of the frames around it, which is what run-to-run comparisons need.
+class Benchmark
+{
+public:
+    int frames = 600;
+    // frames rendered before recording starts (driver warm-up, first texture uses)
+    int warmup = 30;
+    int width = 800;
+    int height = 600;
+
+    // color + depth target the scene is drawn into, left bound
+    bool createTarget(int width, int height)
+    {
+        MEMORY_TAG("benchmark", "render target");
+        this->width = width;
+        this->height = height;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::BENCHMARK::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        glGenQueries(2, timestampQueries);
+        return true;
+    }
+
+    GLuint target() const
+    {
+        return fbo;
+    }
+
+    bool finished() const
+    {
+        return frameIndex >= warmup + frames;
+    }
+
+    // index along the camera path: warm-up frames all show its first pose
+    int pathFrame() const
+    {
+        return std::max(frameIndex - warmup, 0);
+    }
+
+    // deterministic orbit around the scene, one full turn over the recorded frames
+    void placeCamera(Camera &camera) const
+    {
+        const glm::vec3 center(0.0f, -0.3f, -2.0f);
+        float t = (float)pathFrame() / (float)frames;
+        float angle = t * 2.0f * 3.14159265f;
+        glm::vec3 position = center + glm::vec3(std::sin(angle) * 4.5f, 0.6f, std::cos(angle) * 4.5f);
+        glm::vec3 dir = glm::normalize(center - position);
+        camera.SetPose(position, glm::degrees(std::atan2(dir.z, dir.x)), glm::degrees(std::asin(dir.y)));
+    }
+
+    void beginFrame()
+    {
+        frameStart = std::chrono::steady_clock::now();
+        glQueryCounter(timestampQueries[0], GL_TIMESTAMP);
+    }
+
+    // samplesShaded: fragments that passed the depth test this frame, 0 if not measured
+    // drawCalls: from GLCounters when --gl-stats is on, 0 otherwise
+    void endFrame(uint64_t samplesShaded, uint64_t drawCalls = 0)
+    {
+        auto submitted = std::chrono::steady_clock::now();
+        glQueryCounter(timestampQueries[1], GL_TIMESTAMP);
+        glFinish();
+        auto done = std::chrono::steady_clock::now();
+
+        GLuint64 gpuStart = 0, gpuEnd = 0;
+        glGetQueryObjectui64v(timestampQueries[0], GL_QUERY_RESULT, &gpuStart);
+        glGetQueryObjectui64v(timestampQueries[1], GL_QUERY_RESULT, &gpuEnd);
+
+        if (frameIndex++ < warmup)
+            return;
+        frameMs.push_back(std::chrono::duration<double, std::milli>(done - frameStart).count());
+        submitMs.push_back(std::chrono::duration<double, std::milli>(submitted - frameStart).count());
+        gpuMs.push_back((gpuEnd - gpuStart) / 1.0e6);
+        samples.push_back(samplesShaded);
+        draws.push_back(drawCalls);
+    }
+
+    // extraFields: additional "key": value pairs (without surrounding braces) describing the run
+    void writeJson(std::ostream &out, const std::string &extraFields = "") const
+    {
+        const GLubyte *renderer = glGetString(GL_RENDERER);
+        uint64_t totalSamples = 0;
+        for (uint64_t s : samples)
+            totalSamples += s;
+        uint64_t totalDraws = 0;
+        for (uint64_t d : draws)
+            totalDraws += d;
+
+        out << std::fixed << std::setprecision(4);
+        out << "{\n";
+        out << "  \"renderer\": \"" << escape(renderer ? (const char*)renderer : "") << "\",\n";
+        out << "  \"width\": " << width << ",\n";
+        out << "  \"height\": " << height << ",\n";
+        out << "  \"frames\": " << frameMs.size() << ",\n";
+        out << "  \"warmup_frames\": " << warmup << ",\n";
+        if (!extraFields.empty())
+            out << "  " << extraFields << ",\n";
+        out << "  \"frame_time_ms\": " << summary(frameMs) << ",\n";
+        out << "  \"cpu_submit_ms\": " << summary(submitMs) << ",\n";
+        out << "  \"gpu_ms\": " << summary(gpuMs) << ",\n";
+        out << "  \"peak_rss_mb\": " << peakResidentBytes() / (1024.0 * 1024.0) << ",\n";
+        out << "  \"samples_shaded_per_frame\": " << (samples.empty() ? 0 : totalSamples / samples.size()) << ",\n";
+        out << "  \"draw_calls_per_frame\": " << (draws.empty() ? 0.0 : (double)totalDraws / draws.size()) << ",\n";
+        out << "  \"frame_times_ms\": [";
+        for (size_t i = 0; i < frameMs.size(); i++)
+            out << (i ? ", " : "") << frameMs[i];
+        out << "]\n}" << std::endl;
+    }
+
+    // high-water mark of the process's resident memory, including what the driver mapped into it
+    static uint64_t peakResidentBytes()
+    {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return (uint64_t)usage.ru_maxrss;
+#else
+        return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+    }
+
+    // call while the context is still current
+    void release()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (fbo)
+            glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(2, renderbuffers);
+        glDeleteQueries(2, timestampQueries);
+        fbo = 0;
+    }
+
+private:
+    GLuint fbo = 0;
+    GLuint renderbuffers[2] = {};
+    GLuint timestampQueries[2] = {};
+    int frameIndex = 0;
+    std::chrono::steady_clock::time_point frameStart;
+
+    std::vector<double> frameMs;
+    std::vector<double> submitMs;
+    std::vector<double> gpuMs;
+    std::vector<uint64_t> samples;
+    std::vector<uint64_t> draws;
+
+    // nearest-rank percentile
+    static double percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+    }
+
+    static std::string summary(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (double v : values)
+            sum += v;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(4)
+            << "{\"p50\": " << percentile(values, 50) << ", \"p95\": " << percentile(values, 95)
+            << ", \"p99\": " << percentile(values, 99) << ", \"mean\": " << (values.empty() ? 0.0 : sum / values.size())
+            << ", \"max\": " << (values.empty() ? 0.0 : values.back()) << "}";
+        return out.str();
+    }
+
+    static std::string escape(const char *text)
+    {
+        std::string escaped;
+        for (const char *c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                escaped += '\\';
+            if ((unsigned char)*c >= 0x20)
+                escaped += *c;
+        }
+        return escaped;
+    }
+};
+#endif
@@ -0,0 +1,167 @@
+#ifndef CAMERA_RECORDER_H
+#define CAMERA_RECORDER_H
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One camera state per rendered frame. Text, one sample per line, so paths can be diffed and
+// trimmed by hand:
+//     # camera path v1: time x y z yaw pitch zoom flashlight
+//     0.016667 0 0 3 -90 0 45 0
+struct CameraSample
+{
+    double time = 0.0;
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = YAW;
+    float pitch = PITCH;
+    float zoom = ZOOM;
+    bool flashlight = false;
+};
+
+// --record file: appends the camera state after every frame's input has been applied
+class CameraRecorder
+{
+public:
+    bool open(const std::string &path)
+    {
+        file.open(path, std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "ERROR::CAMERA_RECORDER::OPEN_FAILED " << path << std::endl;
+            return false;
+        }
+        file << "# camera path v1: time x y z yaw pitch zoom flashlight\n" << std::setprecision(9);
+        return true;
+    }
+
+    bool isRecording() const
+    {
+        return file.is_open();
+    }
+
+    // time: seconds since the recording started
+    void record(double time, const Camera &camera, bool flashlight)
+    {
+        if (!file.is_open())
+            return;
+        file << time << ' ' << camera.Position.x << ' ' << camera.Position.y << ' ' << camera.Position.z << ' '
+             << camera.Yaw << ' ' << camera.Pitch << ' ' << camera.Zoom << ' ' << (flashlight ? 1 : 0) << '\n';
+    }
+
+    void close()
+    {
+        if (file.is_open())
+            file.close();
+    }
+
+private:
+    std::ofstream file;
+};
+
+// --play file: drives the camera from a recording at a fixed timestep instead of live input.
+// Frame n shows the recorded state at n * timestep, interpolated between the samples around it,
+// so a path recorded at any frame rate replays as the same frame sequence on every machine.
+class CameraPath
+{
+public:
+    // seconds of recorded time advanced per rendered frame
+    double timestep = 1.0 / 60.0;
+
+    bool load(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::CAMERA_PATH::FILE_NOT_FOUND " << path << std::endl;
+            return false;
+        }
+        samples.clear();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream in(line);
+            CameraSample sample;
+            int flashlight = 0;
+            if (!(in >> sample.time >> sample.position.x >> sample.position.y >> sample.position.z
+                     >> sample.yaw >> sample.pitch >> sample.zoom >> flashlight))
+            {
+                std::cout << "ERROR::CAMERA_PATH::BAD_SAMPLE " << line << std::endl;
+                return false;
+            }
+            sample.flashlight = flashlight != 0;
+            if (!samples.empty() && sample.time < samples.back().time)
+            {
+                std::cout << "ERROR::CAMERA_PATH::TIME_GOES_BACKWARDS " << line << std::endl;
+                return false;
+            }
+            samples.push_back(sample);
+        }
+        if (samples.empty())
+        {
+            std::cout << "ERROR::CAMERA_PATH::EMPTY " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // frames needed to play the whole recording, the first frame showing its first sample
+    int frameCount() const
+    {
+        if (samples.empty())
+            return 0;
+        return (int)std::floor((samples.back().time - samples.front().time) / timestep) + 1;
+    }
+
+    bool finished(int frame) const
+    {
+        return frame >= frameCount();
+    }
+
+    CameraSample sampleAt(int frame) const
+    {
+        double time = samples.front().time + frame * timestep;
+        auto after = std::upper_bound(samples.begin(), samples.end(), time,
+                                      [](double t, const CameraSample &sample) { return t < sample.time; });
+        if (after == samples.begin())
+            return samples.front();
+        if (after == samples.end())
+            return samples.back();
+        const CameraSample &a = *(after - 1);
+        const CameraSample &b = *after;
+        float t = b.time > a.time ? (float)((time - a.time) / (b.time - a.time)) : 0.0f;
+
+        CameraSample sample;
+        sample.time = time;
+        sample.position = glm::mix(a.position, b.position, t);
+        sample.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        sample.pitch = a.pitch + (b.pitch - a.pitch) * t;
+        sample.zoom = a.zoom + (b.zoom - a.zoom) * t;
+        // toggles take effect at the frame they were recorded on
+        sample.flashlight = a.flashlight;
+        return sample;
+    }
+
+    void apply(int frame, Camera &camera, bool &flashlight) const
+    {
+        CameraSample sample = sampleAt(frame);
+        camera.SetPose(sample.position, sample.yaw, sample.pitch);
+        camera.Zoom = sample.zoom;
+        flashlight = sample.flashlight;
+    }
+
+private:
+    std::vector<CameraSample> samples;
+};
+#endif
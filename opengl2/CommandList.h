@@ -0,0 +1,229 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator over a chain of blocks. Allocation is a pointer increment, nothing is freed one
+// by one: reset() rewinds to the first block and keeps them all, so after the first few frames
+// recording allocates nothing. Not thread safe, every recording thread has its own.
+class LinearArena
+{
+public:
+    explicit LinearArena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        assert((alignment & (alignment - 1)) == 0);
+        while (true)
+        {
+            if (block < blocks.size())
+            {
+                uintptr_t base = (uintptr_t)blocks[block].data();
+                uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+                if (aligned + bytes <= base + blocks[block].size())
+                {
+                    offset = aligned + bytes - base;
+                    return (void*)aligned;
+                }
+                block++;
+                offset = 0;
+                continue;
+            }
+            blocks.emplace_back(std::max(blockSize, bytes + alignment), TrackedAllocator<char>(MemoryTracker::tag("command lists")));
+        }
+    }
+
+    // drops everything allocated, keeping the memory
+    void reset()
+    {
+        block = 0;
+        offset = 0;
+    }
+
+    size_t capacity() const
+    {
+        size_t bytes = 0;
+        for (const TrackedVector<char> &memory : blocks)
+            bytes += memory.size();
+        return bytes;
+    }
+
+private:
+    size_t blockSize;
+    std::vector<TrackedVector<char>> blocks;
+    size_t block = 0;
+    size_t offset = 0;
+};
+
+// Commands of type T appended one after the other into chunks taken from an arena. Commands are
+// plain data and are dropped with the arena, nothing runs their destructors.
+template <typename T>
+class CommandList
+{
+    static_assert(std::is_trivially_destructible<T>::value, "commands are dropped without running destructors");
+
+public:
+    explicit CommandList(LinearArena &arena) : arena(arena) {}
+
+    T& push(const T &command)
+    {
+        if (chunks.empty() || chunks.back().count == CHUNK_SIZE)
+            chunks.push_back({ (T*)arena.allocate(sizeof(T) * CHUNK_SIZE, alignof(T)), 0 });
+        Chunk &chunk = chunks.back();
+        T* slot = new (chunk.items + chunk.count++) T(command);
+        count++;
+        return *slot;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    // forgets the commands, call before resetting the arena they live in
+    void clear()
+    {
+        chunks.clear();
+        count = 0;
+    }
+
+    template <typename Fn>
+    void forEach(Fn &&fn) const
+    {
+        for (const Chunk &chunk : chunks)
+            for (size_t i = 0; i < chunk.count; i++)
+                fn(chunk.items[i]);
+    }
+
+private:
+    // commands per chunk taken from the arena
+    static constexpr size_t CHUNK_SIZE = 256;
+
+    struct Chunk
+    {
+        T* items;
+        size_t count;
+    };
+
+    LinearArena &arena;
+    std::vector<Chunk> chunks;
+    size_t count = 0;
+};
+
+// One frame's commands recorded from any number of job system threads at once. Each thread
+// appends to its own list and arena without locking; merge() then puts all of them in one
+// sequence ordered by the commands' 64 bit key. Keys should be unique (put a sequence number in
+// the low bits) so the order doesn't depend on which thread recorded what.
+//
+// Threads outside the job system pool share one list, so only one of them may record at a time:
+// the thread that calls merge(), e.g. the render thread when the simulation owns the main thread.
+template <typename T>
+class CommandLists
+{
+public:
+    struct Entry
+    {
+        uint64_t key;
+        const T* command;
+    };
+
+    // empties every list and rewinds the arenas. Call before recording, with none in flight.
+    void reset()
+    {
+        size_t needed = JobSystem::get().threadCount() + 1;
+        while (slots.size() < needed)
+            slots.emplace_back(new Slot());
+        for (std::unique_ptr<Slot> &slot : slots)
+        {
+            slot->list.clear();
+            slot->arena.reset();
+        }
+        entries.clear();
+    }
+
+    // the calling thread's list
+    CommandList<T>& local()
+    {
+        int thread = JobSystem::currentThread();
+        return slots[thread < 0 ? slots.size() - 1 : (size_t)thread]->list;
+    }
+
+    // all recorded commands by ascending key. Runs of the sequence are sorted on the job system,
+    // then merged pairwise.
+    const std::vector<Entry>& merge()
+    {
+        size_t total = 0;
+        for (const std::unique_ptr<Slot> &slot : slots)
+            total += slot->list.size();
+        entries.clear();
+        entries.reserve(total);
+        for (const std::unique_ptr<Slot> &slot : slots)
+            slot->list.forEach([this](const T &command) { entries.push_back({ command.key, &command }); });
+
+        auto byKey = [](const Entry &a, const Entry &b) { return a.key < b.key; };
+        JobSystem &jobs = JobSystem::get();
+        size_t runLength = std::max<size_t>(MIN_RUN, (total + jobs.threadCount() - 1) / jobs.threadCount());
+        size_t runs = (total + runLength - 1) / runLength;
+        jobs.parallelFor(runs, [&](size_t begin, size_t end) {
+            for (size_t run = begin; run < end; run++)
+                std::sort(entries.begin() + run * runLength, entries.begin() + std::min((run + 1) * runLength, total), byKey);
+        }, 1);
+        for (size_t width = runLength; width < total; width *= 2)
+        {
+            size_t pairs = (total + 2 * width - 1) / (2 * width);
+            jobs.parallelFor(pairs, [&](size_t begin, size_t end) {
+                for (size_t pair = begin; pair < end; pair++)
+                {
+                    size_t first = pair * 2 * width;
+                    size_t middle = std::min(first + width, total);
+                    size_t last = std::min(first + 2 * width, total);
+                    std::inplace_merge(entries.begin() + first, entries.begin() + middle, entries.begin() + last, byKey);
+                }
+            }, 1);
+        }
+        return entries;
+    }
+
+    // the result of the last merge()
+    const std::vector<Entry>& merged() const
+    {
+        return entries;
+    }
+
+    // commands recorded since reset()
+    size_t size() const
+    {
+        size_t total = 0;
+        for (const std::unique_ptr<Slot> &slot : slots)
+            total += slot->list.size();
+        return total;
+    }
+
+private:
+    // below this many commands a sort isn't worth a job
+    static constexpr size_t MIN_RUN = 4096;
+
+    // on its own cache lines, the threads append to neighbouring slots at the same time
+    struct alignas(64) Slot
+    {
+        LinearArena arena;
+        CommandList<T> list{ arena };
+    };
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<Entry> entries;
+};
+#endif
@@ -0,0 +1,178 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "CommandList.h"
+#include "JobSystem.h"
+#include "SceneGen.h"
+#include "ShaderLod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// what a draw command draws, also the order the kinds are submitted in
+enum DrawKind {
+    DRAW_CUBE,
+    DRAW_BACKPACK,
+    DRAW_KIND_COUNT
+};
+
+// one visible object and the uniforms it is drawn with
+struct DrawCommand
+{
+    // kind, then lighting level, then front to back, then the object's index
+    uint64_t key;
+    glm::mat4 model;
+    // uniforms of the lighting level, nearestPointLight for LOD_NEAREST and bakedAmbient for LOD_BAKED
+    glm::vec3 bakedAmbient;
+    int nearestPointLight;
+    int lightingLod;
+    int kind;
+};
+
+// the six planes of a view frustum, pointing inwards
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4 &viewProjection)
+    {
+        glm::mat4 m = glm::transpose(viewProjection);
+        planes[0] = m[3] + m[0];
+        planes[1] = m[3] - m[0];
+        planes[2] = m[3] + m[1];
+        planes[3] = m[3] - m[1];
+        planes[4] = m[3] + m[2];
+        planes[5] = m[3] - m[2];
+        for (glm::vec4 &plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const
+    {
+        for (const glm::vec4 &plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        return true;
+    }
+};
+
+// The scene's cubes and backpacks as one frame of draw commands. record() culls every object
+// against the view, picks its lighting level and works out that level's uniforms, spread over the
+// job system; the render thread then only walks the sorted commands and issues GL calls. Sorting
+// by kind and level keeps shader and LOD query switches to a handful per frame, and front to back
+// within them lets early depth testing reject what's hidden.
+class DrawList
+{
+public:
+    // what the scene looks like from where, and how lighting levels are picked
+    struct View
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        float viewportHeight;
+        float farPlane;
+        const LodSelector* lodSelector;
+        const std::vector<PointLight>* lights;
+    };
+
+    // per object: cubes are unit cubes at positions, backpacks are the mesh bounds under models.
+    // Levels are read and updated for every object, culled or not.
+    void record(const View &frame, const std::vector<glm::vec3> &cubes, float cubeRadius, std::vector<int> &cubeLod,
+                const std::vector<glm::mat4> &models, const glm::vec3 &boundsCenter, float boundsRadius, std::vector<int> &modelLod)
+    {
+        commands.reset();
+        Frustum frustum(frame.projection * frame.view);
+        size_t objects = cubes.size() + models.size();
+        JobSystem::get().parallelFor(objects, [&](size_t begin, size_t end) {
+            CommandList<DrawCommand> &list = commands.local();
+            for (size_t i = begin; i < end; i++)
+            {
+                DrawCommand draw;
+                glm::vec3 center;
+                float radius;
+                int* level;
+                if (i < cubes.size())
+                {
+                    draw.kind = DRAW_CUBE;
+                    draw.model = glm::translate(glm::mat4(1.0f), cubes[i]);
+                    center = cubes[i];
+                    radius = cubeRadius;
+                    level = &cubeLod[i];
+                }
+                else
+                {
+                    size_t model = i - cubes.size();
+                    draw.kind = DRAW_BACKPACK;
+                    draw.model = models[model];
+                    center = glm::vec3(draw.model * glm::vec4(boundsCenter, 1.0f));
+                    radius = boundsRadius;
+                    level = &modelLod[model];
+                }
+                float pixels = LodSelector::projectedDiameter(center, radius, frame.view, frame.projection, frame.viewportHeight);
+                *level = frame.lodSelector->select(*level, pixels);
+                if (!frustum.intersectsSphere(center, radius))
+                    continue;
+                draw.lightingLod = *level;
+                setLightingUniforms(draw, center, *frame.lights);
+                float distance = glm::clamp(-(frame.view * glm::vec4(center, 1.0f)).z / frame.farPlane, 0.0f, 1.0f);
+                draw.key = (uint64_t)draw.kind << 62 | (uint64_t)draw.lightingLod << 60
+                         | (uint64_t)(distance * DEPTH_STEPS) << 32 | (uint64_t)i;
+                list.push(draw);
+            }
+        });
+        commands.merge();
+    }
+
+    // the visible objects' commands in submission order
+    const std::vector<CommandLists<DrawCommand>::Entry>& sorted() const
+    {
+        return commands.merged();
+    }
+
+    // [first, last) indices into sorted() of the commands of one kind
+    std::pair<size_t, size_t> range(int kind) const
+    {
+        const auto &entries = commands.merged();
+        auto byKey = [](const CommandLists<DrawCommand>::Entry &entry, uint64_t key) { return entry.key < key; };
+        size_t first = std::lower_bound(entries.begin(), entries.end(), (uint64_t)kind << 62, byKey) - entries.begin();
+        size_t last = kind + 1 < DRAW_KIND_COUNT
+                    ? std::lower_bound(entries.begin(), entries.end(), (uint64_t)(kind + 1) << 62, byKey) - entries.begin()
+                    : entries.size();
+        return { first, last };
+    }
+
+private:
+    // 28 bits of view distance in the key
+    static constexpr double DEPTH_STEPS = (double)((1u << 28) - 1);
+
+    CommandLists<DrawCommand> commands;
+
+    // the lighting level's uniforms, evaluated at the object's center
+    static void setLightingUniforms(DrawCommand &draw, const glm::vec3 &center, const std::vector<PointLight> &pointLights)
+    {
+        draw.nearestPointLight = 0;
+        draw.bakedAmbient = glm::vec3(0.0f);
+        if (draw.lightingLod == LOD_NEAREST)
+        {
+            for (int i = 1; i < (int)pointLights.size(); i++)
+                if (glm::distance(center, pointLights[i].position) < glm::distance(center, pointLights[draw.nearestPointLight].position))
+                    draw.nearestPointLight = i;
+        }
+        else if (draw.lightingLod == LOD_BAKED)
+        {
+            // same ambient and attenuation as the pointLights[] uniforms
+            for (const PointLight &light : pointLights)
+            {
+                float distance = glm::distance(center, light.position);
+                draw.bakedAmbient += light.ambient / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+            }
+        }
+    }
+};
+#endif
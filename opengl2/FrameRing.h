@@ -0,0 +1,261 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// a piece of the current frame's region: where it is in the buffer and where to write it
+struct FrameSpan
+{
+    GLintptr offset = 0;
+    char* data = nullptr;
+    size_t bytes = 0;
+
+    // copies value in at offset. Mapped memory may be write-combined: write whole values, don't
+    // read back.
+    template <typename T>
+    void write(size_t at, const T &value) const
+    {
+        if (data && at + sizeof(T) <= bytes)
+            std::memcpy(data + at, &value, sizeof(T));
+    }
+};
+
+// Per-frame uniform data in one buffer split into framesInFlight regions, the CPU writing one
+// while the GPU still reads the ones before it. endFrame() puts a fence after the frame's draws,
+// beginFrame() waits on the fence of the region it is about to reuse, so a region is only written
+// once the GPU is done with it and no driver call ever has to synchronize or orphan behind our
+// back. Writes are plain memcpy into the spans allocate() hands out; draws then bind their span
+// with bind().
+//
+// With buffer storage (GL 4.4) the buffer stays mapped persistent and coherent for its lifetime.
+// Without, each frame maps its region unsynchronized, the fences already say it's free. Unmapped
+// mode writes into a CPU copy instead and commit() uploads it with glBufferSubData, which is what
+// --capture needs to record the data.
+class FrameRing
+{
+public:
+    // call with the context current. regionBytes grows when a frame asks for more.
+    void init(size_t regionBytes, int framesInFlight, bool mapped = true)
+    {
+        frames = std::max(1, framesInFlight);
+        this->mapped = mapped;
+        persistent = mapped && glExt.bufferStorage;
+        GLint offsetAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        // std140 needs 16 anyway, and a driver reporting nothing gets the largest common value
+        alignment = offsetAlignment > 0 ? std::max<size_t>(16, offsetAlignment) : 256;
+        fences.assign(frames, nullptr);
+        create(align(regionBytes));
+    }
+
+    bool isRunning() const
+    {
+        return buffer != 0;
+    }
+
+    bool isPersistent() const
+    {
+        return persistent;
+    }
+
+    int framesInFlight() const
+    {
+        return frames;
+    }
+
+    // bytes rounded up to where the next bindable span may start
+    size_t align(size_t bytes) const
+    {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    // starts writing the next region once the GPU is done with it, growing the buffer first when
+    // bytes (the sum of the frame's aligned allocations) don't fit
+    void beginFrame(size_t bytes)
+    {
+        PROFILE_SCOPE("FrameRing::beginFrame");
+        if (bytes > regionBytes)
+        {
+            // every region may still be in use, the old buffer can only go once all are done
+            for (int i = 0; i < frames; i++)
+                waitFor(i);
+            destroy();
+            create(align(std::max(bytes, regionBytes * 2)));
+        }
+        region = (int)(frame % frames);
+        waitFor(region);
+        used = 0;
+        if (persistent)
+            write = base + regionOffset();
+        else if (mapped)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            write = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, regionOffset(), regionBytes,
+                                            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            if (!write)
+                std::cout << "ERROR::FRAME_RING::MAP_FAILED" << std::endl;
+        }
+        else
+            write = staging.data();
+    }
+
+    // bytes of the current region, starting at a bindable offset. Spans beyond what beginFrame()
+    // was told about come back empty.
+    FrameSpan allocate(size_t bytes)
+    {
+        FrameSpan span;
+        if (!write || used + bytes > regionBytes)
+        {
+            std::cout << "ERROR::FRAME_RING::REGION_FULL: " << bytes << " bytes" << std::endl;
+            return span;
+        }
+        span.offset = (GLintptr)(regionOffset() + used);
+        span.data = write + used;
+        span.bytes = bytes;
+        used = align(used + bytes);
+        return span;
+    }
+
+    // makes this frame's writes visible to GL, call after writing and before the first draw.
+    // Nothing can be allocated after it until the next beginFrame().
+    void commit()
+    {
+        if (persistent || !write)
+            return;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (mapped)
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        else if (used > 0)
+            glBufferSubData(GL_UNIFORM_BUFFER, regionOffset(), used, staging.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        write = nullptr;
+    }
+
+    // binds bytes of span at offset to a uniform block binding point, all of it by default
+    void bind(GLuint binding, const FrameSpan &span, size_t offset = 0, size_t bytes = 0) const
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, span.offset + offset, bytes ? bytes : span.bytes - offset);
+    }
+
+    // fences the current region, call once the frame's last draw reading it was issued
+    void endFrame()
+    {
+        commit();
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame++;
+    }
+
+    // beginFrame() calls that found their region still in use, and how long they waited
+    uint64_t stallCount() const
+    {
+        return stalls;
+    }
+
+    double stallMs() const
+    {
+        return stalledMs;
+    }
+
+    void release()
+    {
+        for (int i = 0; i < frames; i++)
+            waitFor(i);
+        destroy();
+    }
+
+private:
+    int frames = 1;
+    bool mapped = true;
+    bool persistent = false;
+    size_t alignment = 256;
+    size_t regionBytes = 0;
+    GLuint buffer = 0;
+    // the whole persistent mapping
+    char* base = nullptr;
+    // the current region, mapped or staged
+    char* write = nullptr;
+    TrackedVector<char> staging;
+    std::vector<GLsync> fences;
+    uint64_t frame = 0;
+    int region = 0;
+    size_t used = 0;
+    uint64_t stalls = 0;
+    double stalledMs = 0.0;
+
+    size_t regionOffset() const
+    {
+        return (size_t)region * regionBytes;
+    }
+
+    void create(size_t bytes)
+    {
+        MEMORY_TAG("frame ring", "uniforms");
+        regionBytes = bytes;
+        size_t total = regionBytes * frames;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glExt.BufferStorage(GL_UNIFORM_BUFFER, total, NULL, flags);
+            base = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, total, flags);
+            if (!base)
+                std::cout << "ERROR::FRAME_RING::MAP_FAILED" << std::endl;
+        }
+        else
+            glBufferData(GL_UNIFORM_BUFFER, total, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        if (!mapped)
+            staging = TrackedVector<char>(regionBytes, TrackedAllocator<char>(MemoryTracker::tag("frame ring", "staging")));
+        write = nullptr;
+    }
+
+    void destroy()
+    {
+        if (!buffer)
+            return;
+        if (base || (mapped && !persistent && write))
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        base = nullptr;
+        write = nullptr;
+    }
+
+    // blocks until the GPU finished the frame that last used region i
+    void waitFor(int i)
+    {
+        if (!fences[i])
+            return;
+        GLenum status = glClientWaitSync(fences[i], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            auto start = std::chrono::steady_clock::now();
+            while (status == GL_TIMEOUT_EXPIRED)
+                status = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            stalls++;
+            stalledMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (status == GL_WAIT_FAILED)
+            std::cout << "ERROR::FRAME_RING::WAIT_FAILED" << std::endl;
+        glDeleteSync(fences[i]);
+        fences[i] = nullptr;
+    }
+};
+#endif
@@ -0,0 +1,951 @@
+#ifndef GL_CAPTURE_H
+#define GL_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include "GLCounters.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GL command stream capture (--capture) and replay (--replay).
+//
+// GLCapture swaps the glad_gl* pointers for wrappers that append each call to a binary file,
+// including the buffer, texture and shader source payloads, and then call the driver. It records
+// the entry points that change what gets drawn. Queries and other glGet* calls are left out
+// because they only read state back. Object names, uniform locations and uniform block indices
+// are recorded as the driver returned them and remapped on replay, so a capture replays on any
+// driver. Writes through mapped buffers never pass a GL call, data a capture needs has to go in
+// with glBufferData/glBufferSubData. Capture has to start right after the context is created, so
+// the setup calls the frames depend on are included.
+//
+// File layout: "GLCP", a version, then records of a uint16 opcode followed by its arguments.
+// Payloads are a uint32 byte count followed by the bytes.
+
+namespace GLStream
+{
+    enum Op : uint16_t
+    {
+        END_FRAME = 1,
+        GEN_BUFFERS, GEN_VERTEX_ARRAYS, GEN_TEXTURES, GEN_FRAMEBUFFERS, GEN_RENDERBUFFERS,
+        CREATE_SHADER, CREATE_PROGRAM,
+        DELETE_BUFFERS, DELETE_VERTEX_ARRAYS, DELETE_TEXTURES, DELETE_FRAMEBUFFERS, DELETE_RENDERBUFFERS,
+        DELETE_SHADER, DELETE_PROGRAM,
+        BIND_BUFFER, BIND_VERTEX_ARRAY, BIND_TEXTURE, ACTIVE_TEXTURE, BIND_FRAMEBUFFER, BIND_RENDERBUFFER,
+        USE_PROGRAM,
+        BUFFER_DATA, BUFFER_SUB_DATA, TEX_IMAGE_2D, TEX_SUB_IMAGE_2D, TEX_PARAMETERI, GENERATE_MIPMAP,
+        PIXEL_STOREI, RENDERBUFFER_STORAGE, FRAMEBUFFER_RENDERBUFFER, FRAMEBUFFER_TEXTURE_2D,
+        VERTEX_ATTRIB_POINTER, VERTEX_ATTRIB_I_POINTER, ENABLE_VERTEX_ATTRIB_ARRAY,
+        SHADER_SOURCE, COMPILE_SHADER, ATTACH_SHADER, DETACH_SHADER, LINK_PROGRAM, GET_UNIFORM_LOCATION,
+        UNIFORM_1I, UNIFORM_1F, UNIFORM_2F, UNIFORM_3F, UNIFORM_4F,
+        UNIFORM_2FV, UNIFORM_3FV, UNIFORM_4FV, UNIFORM_MATRIX_2FV, UNIFORM_MATRIX_3FV, UNIFORM_MATRIX_4FV,
+        ENABLE, DISABLE, DEPTH_FUNC, DEPTH_MASK, COLOR_MASK, BLEND_FUNC, VIEWPORT, SCISSOR, POLYGON_MODE,
+        CLEAR_COLOR, CLEAR,
+        DRAW_ARRAYS, DRAW_ELEMENTS, DRAW_ARRAYS_INSTANCED, DRAW_ELEMENTS_INSTANCED,
+        GET_UNIFORM_BLOCK_INDEX, UNIFORM_BLOCK_BINDING, BIND_BUFFER_RANGE
+    };
+
+    const char MAGIC[4] = { 'G', 'L', 'C', 'P' };
+    const uint32_t VERSION = 1;
+}
+
+class GLCapture
+{
+public:
+    // starts recording into path, for frames frames. Call after gladLoadGLLoader and
+    // loadGLExtensions, before any GL object is created.
+    static bool install(const std::string &path, int frames)
+    {
+        out.open(path, std::ios::binary);
+        if (!out)
+        {
+            std::cout << "ERROR::GLCAPTURE::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        out.write(GLStream::MAGIC, sizeof(GLStream::MAGIC));
+        put(GLStream::VERSION);
+        framesLeft = frames;
+        recording = true;
+
+        wrap(glad_glGenBuffers, real.GenBuffers, &GenBuffers);
+        wrap(glad_glGenVertexArrays, real.GenVertexArrays, &GenVertexArrays);
+        wrap(glad_glGenTextures, real.GenTextures, &GenTextures);
+        wrap(glad_glGenFramebuffers, real.GenFramebuffers, &GenFramebuffers);
+        wrap(glad_glGenRenderbuffers, real.GenRenderbuffers, &GenRenderbuffers);
+        wrap(glad_glCreateShader, real.CreateShader, &CreateShader);
+        wrap(glad_glCreateProgram, real.CreateProgram, &CreateProgram);
+        wrap(glad_glDeleteBuffers, real.DeleteBuffers, &DeleteBuffers);
+        wrap(glad_glDeleteVertexArrays, real.DeleteVertexArrays, &DeleteVertexArrays);
+        wrap(glad_glDeleteTextures, real.DeleteTextures, &DeleteTextures);
+        wrap(glad_glDeleteFramebuffers, real.DeleteFramebuffers, &DeleteFramebuffers);
+        wrap(glad_glDeleteRenderbuffers, real.DeleteRenderbuffers, &DeleteRenderbuffers);
+        wrap(glad_glDeleteShader, real.DeleteShader, &DeleteShader);
+        wrap(glad_glDeleteProgram, real.DeleteProgram, &DeleteProgram);
+        wrap(glad_glBindBuffer, real.BindBuffer, &BindBuffer);
+        wrap(glad_glBindVertexArray, real.BindVertexArray, &BindVertexArray);
+        wrap(glad_glBindTexture, real.BindTexture, &BindTexture);
+        wrap(glad_glActiveTexture, real.ActiveTexture, &ActiveTexture);
+        wrap(glad_glBindFramebuffer, real.BindFramebuffer, &BindFramebuffer);
+        wrap(glad_glBindRenderbuffer, real.BindRenderbuffer, &BindRenderbuffer);
+        wrap(glad_glUseProgram, real.UseProgram, &UseProgram);
+        wrap(glad_glBufferData, real.BufferData, &BufferData);
+        wrap(glad_glBufferSubData, real.BufferSubData, &BufferSubData);
+        wrap(glad_glTexImage2D, real.TexImage2D, &TexImage2D);
+        wrap(glad_glTexSubImage2D, real.TexSubImage2D, &TexSubImage2D);
+        wrap(glad_glTexParameteri, real.TexParameteri, &TexParameteri);
+        wrap(glad_glGenerateMipmap, real.GenerateMipmap, &GenerateMipmap);
+        wrap(glad_glPixelStorei, real.PixelStorei, &PixelStorei);
+        wrap(glad_glRenderbufferStorage, real.RenderbufferStorage, &RenderbufferStorage);
+        wrap(glad_glFramebufferRenderbuffer, real.FramebufferRenderbuffer, &FramebufferRenderbuffer);
+        wrap(glad_glFramebufferTexture2D, real.FramebufferTexture2D, &FramebufferTexture2D);
+        wrap(glad_glVertexAttribPointer, real.VertexAttribPointer, &VertexAttribPointer);
+        wrap(glad_glVertexAttribIPointer, real.VertexAttribIPointer, &VertexAttribIPointer);
+        wrap(glad_glEnableVertexAttribArray, real.EnableVertexAttribArray, &EnableVertexAttribArray);
+        wrap(glad_glShaderSource, real.ShaderSource, &ShaderSource);
+        wrap(glad_glCompileShader, real.CompileShader, &CompileShader);
+        wrap(glad_glAttachShader, real.AttachShader, &AttachShader);
+        wrap(glad_glDetachShader, real.DetachShader, &DetachShader);
+        wrap(glad_glLinkProgram, real.LinkProgram, &LinkProgram);
+        wrap(glad_glGetUniformLocation, real.GetUniformLocation, &GetUniformLocation);
+        wrap(glad_glGetUniformBlockIndex, real.GetUniformBlockIndex, &GetUniformBlockIndex);
+        wrap(glad_glUniformBlockBinding, real.UniformBlockBinding, &UniformBlockBinding);
+        wrap(glad_glBindBufferRange, real.BindBufferRange, &BindBufferRange);
+        wrap(glad_glUniform1i, real.Uniform1i, &Uniform1i);
+        wrap(glad_glUniform1f, real.Uniform1f, &Uniform1f);
+        wrap(glad_glUniform2f, real.Uniform2f, &Uniform2f);
+        wrap(glad_glUniform3f, real.Uniform3f, &Uniform3f);
+        wrap(glad_glUniform4f, real.Uniform4f, &Uniform4f);
+        wrap(glad_glUniform2fv, real.Uniform2fv, &Uniform2fv);
+        wrap(glad_glUniform3fv, real.Uniform3fv, &Uniform3fv);
+        wrap(glad_glUniform4fv, real.Uniform4fv, &Uniform4fv);
+        wrap(glad_glUniformMatrix2fv, real.UniformMatrix2fv, &UniformMatrix2fv);
+        wrap(glad_glUniformMatrix3fv, real.UniformMatrix3fv, &UniformMatrix3fv);
+        wrap(glad_glUniformMatrix4fv, real.UniformMatrix4fv, &UniformMatrix4fv);
+        wrap(glad_glEnable, real.Enable, &Enable);
+        wrap(glad_glDisable, real.Disable, &Disable);
+        wrap(glad_glDepthFunc, real.DepthFunc, &DepthFunc);
+        wrap(glad_glDepthMask, real.DepthMask, &DepthMask);
+        wrap(glad_glColorMask, real.ColorMask, &ColorMask);
+        wrap(glad_glBlendFunc, real.BlendFunc, &BlendFunc);
+        wrap(glad_glViewport, real.Viewport, &Viewport);
+        wrap(glad_glScissor, real.Scissor, &Scissor);
+        wrap(glad_glPolygonMode, real.PolygonMode, &PolygonMode);
+        wrap(glad_glClearColor, real.ClearColor, &ClearColor);
+        wrap(glad_glClear, real.Clear, &Clear);
+        wrap(glad_glDrawArrays, real.DrawArrays, &DrawArrays);
+        wrap(glad_glDrawElements, real.DrawElements, &DrawElements);
+        wrap(glad_glDrawArraysInstanced, real.DrawArraysInstanced, &DrawArraysInstanced);
+        wrap(glad_glDrawElementsInstanced, real.DrawElementsInstanced, &DrawElementsInstanced);
+        return true;
+    }
+
+    static bool isRecording()
+    {
+        return recording;
+    }
+
+    // marks a frame boundary, the file is closed once the requested frames are in
+    static void endFrame()
+    {
+        if (!recording)
+            return;
+        op(GLStream::END_FRAME);
+        if (--framesLeft > 0)
+            return;
+        recording = false;
+        out.close();
+        std::cout << "capture: done" << std::endl;
+    }
+
+private:
+    struct Real
+    {
+        PFNGLGENBUFFERSPROC GenBuffers;
+        PFNGLGENVERTEXARRAYSPROC GenVertexArrays;
+        PFNGLGENTEXTURESPROC GenTextures;
+        PFNGLGENFRAMEBUFFERSPROC GenFramebuffers;
+        PFNGLGENRENDERBUFFERSPROC GenRenderbuffers;
+        PFNGLCREATESHADERPROC CreateShader;
+        PFNGLCREATEPROGRAMPROC CreateProgram;
+        PFNGLDELETEBUFFERSPROC DeleteBuffers;
+        PFNGLDELETEVERTEXARRAYSPROC DeleteVertexArrays;
+        PFNGLDELETETEXTURESPROC DeleteTextures;
+        PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+        PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers;
+        PFNGLDELETESHADERPROC DeleteShader;
+        PFNGLDELETEPROGRAMPROC DeleteProgram;
+        PFNGLBINDBUFFERPROC BindBuffer;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+        PFNGLBINDTEXTUREPROC BindTexture;
+        PFNGLACTIVETEXTUREPROC ActiveTexture;
+        PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+        PFNGLBINDRENDERBUFFERPROC BindRenderbuffer;
+        PFNGLUSEPROGRAMPROC UseProgram;
+        PFNGLBUFFERDATAPROC BufferData;
+        PFNGLBUFFERSUBDATAPROC BufferSubData;
+        PFNGLTEXIMAGE2DPROC TexImage2D;
+        PFNGLTEXSUBIMAGE2DPROC TexSubImage2D;
+        PFNGLTEXPARAMETERIPROC TexParameteri;
+        PFNGLGENERATEMIPMAPPROC GenerateMipmap;
+        PFNGLPIXELSTOREIPROC PixelStorei;
+        PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage;
+        PFNGLFRAMEBUFFERRENDERBUFFERPROC FramebufferRenderbuffer;
+        PFNGLFRAMEBUFFERTEXTURE2DPROC FramebufferTexture2D;
+        PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer;
+        PFNGLVERTEXATTRIBIPOINTERPROC VertexAttribIPointer;
+        PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+        PFNGLSHADERSOURCEPROC ShaderSource;
+        PFNGLCOMPILESHADERPROC CompileShader;
+        PFNGLATTACHSHADERPROC AttachShader;
+        PFNGLDETACHSHADERPROC DetachShader;
+        PFNGLLINKPROGRAMPROC LinkProgram;
+        PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+        PFNGLGETUNIFORMBLOCKINDEXPROC GetUniformBlockIndex;
+        PFNGLUNIFORMBLOCKBINDINGPROC UniformBlockBinding;
+        PFNGLBINDBUFFERRANGEPROC BindBufferRange;
+        PFNGLUNIFORM1IPROC Uniform1i;
+        PFNGLUNIFORM1FPROC Uniform1f;
+        PFNGLUNIFORM2FPROC Uniform2f;
+        PFNGLUNIFORM3FPROC Uniform3f;
+        PFNGLUNIFORM4FPROC Uniform4f;
+        PFNGLUNIFORM2FVPROC Uniform2fv;
+        PFNGLUNIFORM3FVPROC Uniform3fv;
+        PFNGLUNIFORM4FVPROC Uniform4fv;
+        PFNGLUNIFORMMATRIX2FVPROC UniformMatrix2fv;
+        PFNGLUNIFORMMATRIX3FVPROC UniformMatrix3fv;
+        PFNGLUNIFORMMATRIX4FVPROC UniformMatrix4fv;
+        PFNGLENABLEPROC Enable;
+        PFNGLDISABLEPROC Disable;
+        PFNGLDEPTHFUNCPROC DepthFunc;
+        PFNGLDEPTHMASKPROC DepthMask;
+        PFNGLCOLORMASKPROC ColorMask;
+        PFNGLBLENDFUNCPROC BlendFunc;
+        PFNGLVIEWPORTPROC Viewport;
+        PFNGLSCISSORPROC Scissor;
+        PFNGLPOLYGONMODEPROC PolygonMode;
+        PFNGLCLEARCOLORPROC ClearColor;
+        PFNGLCLEARPROC Clear;
+        PFNGLDRAWARRAYSPROC DrawArrays;
+        PFNGLDRAWELEMENTSPROC DrawElements;
+        PFNGLDRAWARRAYSINSTANCEDPROC DrawArraysInstanced;
+        PFNGLDRAWELEMENTSINSTANCEDPROC DrawElementsInstanced;
+    };
+
+    inline static Real real{};
+    inline static std::ofstream out;
+    inline static bool recording = false;
+    inline static int framesLeft = 0;
+    inline static GLint unpackAlignment = 4;
+
+    template <typename Fn>
+    static void wrap(Fn &slot, Fn &saved, Fn wrapper)
+    {
+        saved = slot;
+        if (slot)
+            slot = wrapper;
+    }
+
+    template <typename T>
+    static void put(T value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static void op(GLStream::Op code)
+    {
+        put<uint16_t>(code);
+    }
+
+    static void payload(const void *data, uint64_t size)
+    {
+        put<uint32_t>((uint32_t)size);
+        if (size)
+            out.write(static_cast<const char*>(data), size);
+    }
+
+    static void names(GLsizei n, const GLuint *values)
+    {
+        put<int32_t>(n);
+        for (GLsizei i = 0; i < n; i++)
+            put<uint32_t>(values[i]);
+    }
+
+    // size of an image the driver reads from client memory, rows padded to GL_UNPACK_ALIGNMENT
+    static uint64_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type)
+    {
+        uint64_t row = (uint64_t)width * GLCounters::pixelBytes(format, type);
+        row = (row + unpackAlignment - 1) / unpackAlignment * unpackAlignment;
+        return row * height;
+    }
+
+    // object creation, the names are recorded after the driver generated them
+    static void APIENTRY GenBuffers(GLsizei n, GLuint *v) { real.GenBuffers(n, v); if (recording) { op(GLStream::GEN_BUFFERS); names(n, v); } }
+    static void APIENTRY GenVertexArrays(GLsizei n, GLuint *v) { real.GenVertexArrays(n, v); if (recording) { op(GLStream::GEN_VERTEX_ARRAYS); names(n, v); } }
+    static void APIENTRY GenTextures(GLsizei n, GLuint *v) { real.GenTextures(n, v); if (recording) { op(GLStream::GEN_TEXTURES); names(n, v); } }
+    static void APIENTRY GenFramebuffers(GLsizei n, GLuint *v) { real.GenFramebuffers(n, v); if (recording) { op(GLStream::GEN_FRAMEBUFFERS); names(n, v); } }
+    static void APIENTRY GenRenderbuffers(GLsizei n, GLuint *v) { real.GenRenderbuffers(n, v); if (recording) { op(GLStream::GEN_RENDERBUFFERS); names(n, v); } }
+    static GLuint APIENTRY CreateShader(GLenum type)
+    {
+        GLuint name = real.CreateShader(type);
+        if (recording) { op(GLStream::CREATE_SHADER); put<uint32_t>(type); put<uint32_t>(name); }
+        return name;
+    }
+    static GLuint APIENTRY CreateProgram()
+    {
+        GLuint name = real.CreateProgram();
+        if (recording) { op(GLStream::CREATE_PROGRAM); put<uint32_t>(name); }
+        return name;
+    }
+    static void APIENTRY DeleteBuffers(GLsizei n, const GLuint *v) { if (recording) { op(GLStream::DELETE_BUFFERS); names(n, v); } real.DeleteBuffers(n, v); }
+    static void APIENTRY DeleteVertexArrays(GLsizei n, const GLuint *v) { if (recording) { op(GLStream::DELETE_VERTEX_ARRAYS); names(n, v); } real.DeleteVertexArrays(n, v); }
+    static void APIENTRY DeleteTextures(GLsizei n, const GLuint *v) { if (recording) { op(GLStream::DELETE_TEXTURES); names(n, v); } real.DeleteTextures(n, v); }
+    static void APIENTRY DeleteFramebuffers(GLsizei n, const GLuint *v) { if (recording) { op(GLStream::DELETE_FRAMEBUFFERS); names(n, v); } real.DeleteFramebuffers(n, v); }
+    static void APIENTRY DeleteRenderbuffers(GLsizei n, const GLuint *v) { if (recording) { op(GLStream::DELETE_RENDERBUFFERS); names(n, v); } real.DeleteRenderbuffers(n, v); }
+    static void APIENTRY DeleteShader(GLuint s) { if (recording) { op(GLStream::DELETE_SHADER); put<uint32_t>(s); } real.DeleteShader(s); }
+    static void APIENTRY DeleteProgram(GLuint p) { if (recording) { op(GLStream::DELETE_PROGRAM); put<uint32_t>(p); } real.DeleteProgram(p); }
+
+    // binds
+    static void APIENTRY BindBuffer(GLenum t, GLuint b) { if (recording) { op(GLStream::BIND_BUFFER); put<uint32_t>(t); put<uint32_t>(b); } real.BindBuffer(t, b); }
+    static void APIENTRY BindVertexArray(GLuint a) { if (recording) { op(GLStream::BIND_VERTEX_ARRAY); put<uint32_t>(a); } real.BindVertexArray(a); }
+    static void APIENTRY BindTexture(GLenum t, GLuint x) { if (recording) { op(GLStream::BIND_TEXTURE); put<uint32_t>(t); put<uint32_t>(x); } real.BindTexture(t, x); }
+    static void APIENTRY ActiveTexture(GLenum u) { if (recording) { op(GLStream::ACTIVE_TEXTURE); put<uint32_t>(u); } real.ActiveTexture(u); }
+    static void APIENTRY BindFramebuffer(GLenum t, GLuint f) { if (recording) { op(GLStream::BIND_FRAMEBUFFER); put<uint32_t>(t); put<uint32_t>(f); } real.BindFramebuffer(t, f); }
+    static void APIENTRY BindRenderbuffer(GLenum t, GLuint r) { if (recording) { op(GLStream::BIND_RENDERBUFFER); put<uint32_t>(t); put<uint32_t>(r); } real.BindRenderbuffer(t, r); }
+    static void APIENTRY UseProgram(GLuint p) { if (recording) { op(GLStream::USE_PROGRAM); put<uint32_t>(p); } real.UseProgram(p); }
+
+    // resources, with their payloads
+    static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+    {
+        if (recording)
+        {
+            op(GLStream::BUFFER_DATA);
+            put<uint32_t>(target);
+            put<uint64_t>(size);
+            put<uint32_t>(usage);
+            payload(data, data ? size : 0);
+        }
+        real.BufferData(target, size, data, usage);
+    }
+    static void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+    {
+        if (recording)
+        {
+            op(GLStream::BUFFER_SUB_DATA);
+            put<uint32_t>(target);
+            put<uint64_t>(offset);
+            payload(data, size);
+        }
+        real.BufferSubData(target, offset, size, data);
+    }
+    static void APIENTRY TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+    {
+        if (recording)
+        {
+            op(GLStream::TEX_IMAGE_2D);
+            put<uint32_t>(target); put<int32_t>(level); put<int32_t>(internalFormat);
+            put<int32_t>(width); put<int32_t>(height); put<int32_t>(border);
+            put<uint32_t>(format); put<uint32_t>(type);
+            payload(pixels, pixels ? imageBytes(width, height, format, type) : 0);
+        }
+        real.TexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+    }
+    static void APIENTRY TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+    {
+        if (recording)
+        {
+            op(GLStream::TEX_SUB_IMAGE_2D);
+            put<uint32_t>(target); put<int32_t>(level); put<int32_t>(x); put<int32_t>(y);
+            put<int32_t>(width); put<int32_t>(height); put<uint32_t>(format); put<uint32_t>(type);
+            payload(pixels, imageBytes(width, height, format, type));
+        }
+        real.TexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+    }
+    static void APIENTRY TexParameteri(GLenum t, GLenum p, GLint v) { if (recording) { op(GLStream::TEX_PARAMETERI); put<uint32_t>(t); put<uint32_t>(p); put<int32_t>(v); } real.TexParameteri(t, p, v); }
+    static void APIENTRY GenerateMipmap(GLenum t) { if (recording) { op(GLStream::GENERATE_MIPMAP); put<uint32_t>(t); } real.GenerateMipmap(t); }
+    static void APIENTRY PixelStorei(GLenum p, GLint v)
+    {
+        if (p == GL_UNPACK_ALIGNMENT)
+            unpackAlignment = v;
+        if (recording) { op(GLStream::PIXEL_STOREI); put<uint32_t>(p); put<int32_t>(v); }
+        real.PixelStorei(p, v);
+    }
+    static void APIENTRY RenderbufferStorage(GLenum t, GLenum f, GLsizei w, GLsizei h) { if (recording) { op(GLStream::RENDERBUFFER_STORAGE); put<uint32_t>(t); put<uint32_t>(f); put<int32_t>(w); put<int32_t>(h); } real.RenderbufferStorage(t, f, w, h); }
+    static void APIENTRY FramebufferRenderbuffer(GLenum t, GLenum a, GLenum rt, GLuint r) { if (recording) { op(GLStream::FRAMEBUFFER_RENDERBUFFER); put<uint32_t>(t); put<uint32_t>(a); put<uint32_t>(rt); put<uint32_t>(r); } real.FramebufferRenderbuffer(t, a, rt, r); }
+    static void APIENTRY FramebufferTexture2D(GLenum t, GLenum a, GLenum tt, GLuint x, GLint l) { if (recording) { op(GLStream::FRAMEBUFFER_TEXTURE_2D); put<uint32_t>(t); put<uint32_t>(a); put<uint32_t>(tt); put<uint32_t>(x); put<int32_t>(l); } real.FramebufferTexture2D(t, a, tt, x, l); }
+
+    // vertex layout, pointers are offsets into the bound GL_ARRAY_BUFFER in the core profile
+    static void APIENTRY VertexAttribPointer(GLuint i, GLint size, GLenum type, GLboolean norm, GLsizei stride, const void *p)
+    {
+        if (recording) { op(GLStream::VERTEX_ATTRIB_POINTER); put<uint32_t>(i); put<int32_t>(size); put<uint32_t>(type); put<uint8_t>(norm); put<int32_t>(stride); put<uint64_t>((uint64_t)(uintptr_t)p); }
+        real.VertexAttribPointer(i, size, type, norm, stride, p);
+    }
+    static void APIENTRY VertexAttribIPointer(GLuint i, GLint size, GLenum type, GLsizei stride, const void *p)
+    {
+        if (recording) { op(GLStream::VERTEX_ATTRIB_I_POINTER); put<uint32_t>(i); put<int32_t>(size); put<uint32_t>(type); put<int32_t>(stride); put<uint64_t>((uint64_t)(uintptr_t)p); }
+        real.VertexAttribIPointer(i, size, type, stride, p);
+    }
+    static void APIENTRY EnableVertexAttribArray(GLuint i) { if (recording) { op(GLStream::ENABLE_VERTEX_ATTRIB_ARRAY); put<uint32_t>(i); } real.EnableVertexAttribArray(i); }
+
+    // shaders, the sources are recorded as one string
+    static void APIENTRY ShaderSource(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths)
+    {
+        if (recording)
+        {
+            std::string source;
+            for (GLsizei i = 0; i < count; i++)
+                source.append(strings[i], lengths && lengths[i] >= 0 ? (size_t)lengths[i] : std::strlen(strings[i]));
+            op(GLStream::SHADER_SOURCE);
+            put<uint32_t>(shader);
+            payload(source.data(), source.size());
+        }
+        real.ShaderSource(shader, count, strings, lengths);
+    }
+    static void APIENTRY CompileShader(GLuint s) { if (recording) { op(GLStream::COMPILE_SHADER); put<uint32_t>(s); } real.CompileShader(s); }
+    static void APIENTRY AttachShader(GLuint p, GLuint s) { if (recording) { op(GLStream::ATTACH_SHADER); put<uint32_t>(p); put<uint32_t>(s); } real.AttachShader(p, s); }
+    static void APIENTRY DetachShader(GLuint p, GLuint s) { if (recording) { op(GLStream::DETACH_SHADER); put<uint32_t>(p); put<uint32_t>(s); } real.DetachShader(p, s); }
+    static void APIENTRY LinkProgram(GLuint p) { if (recording) { op(GLStream::LINK_PROGRAM); put<uint32_t>(p); } real.LinkProgram(p); }
+    static GLint APIENTRY GetUniformLocation(GLuint program, const GLchar *name)
+    {
+        GLint location = real.GetUniformLocation(program, name);
+        if (recording)
+        {
+            op(GLStream::GET_UNIFORM_LOCATION);
+            put<uint32_t>(program);
+            put<int32_t>(location);
+            payload(name, std::strlen(name));
+        }
+        return location;
+    }
+    static GLuint APIENTRY GetUniformBlockIndex(GLuint program, const GLchar *name)
+    {
+        GLuint index = real.GetUniformBlockIndex(program, name);
+        if (recording)
+        {
+            op(GLStream::GET_UNIFORM_BLOCK_INDEX);
+            put<uint32_t>(program);
+            put<uint32_t>(index);
+            payload(name, std::strlen(name));
+        }
+        return index;
+    }
+    static void APIENTRY UniformBlockBinding(GLuint p, GLuint i, GLuint b) { if (recording) { op(GLStream::UNIFORM_BLOCK_BINDING); put<uint32_t>(p); put<uint32_t>(i); put<uint32_t>(b); } real.UniformBlockBinding(p, i, b); }
+    static void APIENTRY BindBufferRange(GLenum t, GLuint i, GLuint b, GLintptr offset, GLsizeiptr size)
+    {
+        if (recording) { op(GLStream::BIND_BUFFER_RANGE); put<uint32_t>(t); put<uint32_t>(i); put<uint32_t>(b); put<uint64_t>(offset); put<uint64_t>(size); }
+        real.BindBufferRange(t, i, b, offset, size);
+    }
+
+    // uniforms of the current program
+    static void APIENTRY Uniform1i(GLint l, GLint v0) { if (recording) { op(GLStream::UNIFORM_1I); put<int32_t>(l); put<int32_t>(v0); } real.Uniform1i(l, v0); }
+    static void APIENTRY Uniform1f(GLint l, GLfloat v0) { if (recording) { op(GLStream::UNIFORM_1F); put<int32_t>(l); put(v0); } real.Uniform1f(l, v0); }
+    static void APIENTRY Uniform2f(GLint l, GLfloat v0, GLfloat v1) { if (recording) { op(GLStream::UNIFORM_2F); put<int32_t>(l); put(v0); put(v1); } real.Uniform2f(l, v0, v1); }
+    static void APIENTRY Uniform3f(GLint l, GLfloat v0, GLfloat v1, GLfloat v2) { if (recording) { op(GLStream::UNIFORM_3F); put<int32_t>(l); put(v0); put(v1); put(v2); } real.Uniform3f(l, v0, v1, v2); }
+    static void APIENTRY Uniform4f(GLint l, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { if (recording) { op(GLStream::UNIFORM_4F); put<int32_t>(l); put(v0); put(v1); put(v2); put(v3); } real.Uniform4f(l, v0, v1, v2, v3); }
+    static void uniformArray(GLStream::Op code, GLint l, GLsizei n, const GLfloat *v, int floats)
+    {
+        op(code);
+        put<int32_t>(l);
+        put<int32_t>(n);
+        payload(v, sizeof(GLfloat) * floats * n);
+    }
+    static void APIENTRY Uniform2fv(GLint l, GLsizei n, const GLfloat *v) { if (recording) uniformArray(GLStream::UNIFORM_2FV, l, n, v, 2); real.Uniform2fv(l, n, v); }
+    static void APIENTRY Uniform3fv(GLint l, GLsizei n, const GLfloat *v) { if (recording) uniformArray(GLStream::UNIFORM_3FV, l, n, v, 3); real.Uniform3fv(l, n, v); }
+    static void APIENTRY Uniform4fv(GLint l, GLsizei n, const GLfloat *v) { if (recording) uniformArray(GLStream::UNIFORM_4FV, l, n, v, 4); real.Uniform4fv(l, n, v); }
+    static void APIENTRY UniformMatrix2fv(GLint l, GLsizei n, GLboolean t, const GLfloat *v) { if (recording) { uniformArray(GLStream::UNIFORM_MATRIX_2FV, l, n, v, 4); put<uint8_t>(t); } real.UniformMatrix2fv(l, n, t, v); }
+    static void APIENTRY UniformMatrix3fv(GLint l, GLsizei n, GLboolean t, const GLfloat *v) { if (recording) { uniformArray(GLStream::UNIFORM_MATRIX_3FV, l, n, v, 9); put<uint8_t>(t); } real.UniformMatrix3fv(l, n, t, v); }
+    static void APIENTRY UniformMatrix4fv(GLint l, GLsizei n, GLboolean t, const GLfloat *v) { if (recording) { uniformArray(GLStream::UNIFORM_MATRIX_4FV, l, n, v, 16); put<uint8_t>(t); } real.UniformMatrix4fv(l, n, t, v); }
+
+    // fixed function state
+    static void APIENTRY Enable(GLenum c) { if (recording) { op(GLStream::ENABLE); put<uint32_t>(c); } real.Enable(c); }
+    static void APIENTRY Disable(GLenum c) { if (recording) { op(GLStream::DISABLE); put<uint32_t>(c); } real.Disable(c); }
+    static void APIENTRY DepthFunc(GLenum f) { if (recording) { op(GLStream::DEPTH_FUNC); put<uint32_t>(f); } real.DepthFunc(f); }
+    static void APIENTRY DepthMask(GLboolean m) { if (recording) { op(GLStream::DEPTH_MASK); put<uint8_t>(m); } real.DepthMask(m); }
+    static void APIENTRY ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) { if (recording) { op(GLStream::COLOR_MASK); put<uint8_t>(r); put<uint8_t>(g); put<uint8_t>(b); put<uint8_t>(a); } real.ColorMask(r, g, b, a); }
+    static void APIENTRY BlendFunc(GLenum s, GLenum d) { if (recording) { op(GLStream::BLEND_FUNC); put<uint32_t>(s); put<uint32_t>(d); } real.BlendFunc(s, d); }
+    static void APIENTRY Viewport(GLint x, GLint y, GLsizei w, GLsizei h) { if (recording) { op(GLStream::VIEWPORT); put<int32_t>(x); put<int32_t>(y); put<int32_t>(w); put<int32_t>(h); } real.Viewport(x, y, w, h); }
+    static void APIENTRY Scissor(GLint x, GLint y, GLsizei w, GLsizei h) { if (recording) { op(GLStream::SCISSOR); put<int32_t>(x); put<int32_t>(y); put<int32_t>(w); put<int32_t>(h); } real.Scissor(x, y, w, h); }
+    static void APIENTRY PolygonMode(GLenum f, GLenum m) { if (recording) { op(GLStream::POLYGON_MODE); put<uint32_t>(f); put<uint32_t>(m); } real.PolygonMode(f, m); }
+    static void APIENTRY ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) { if (recording) { op(GLStream::CLEAR_COLOR); put(r); put(g); put(b); put(a); } real.ClearColor(r, g, b, a); }
+    static void APIENTRY Clear(GLbitfield m) { if (recording) { op(GLStream::CLEAR); put<uint32_t>(m); } real.Clear(m); }
+
+    // draws
+    static void APIENTRY DrawArrays(GLenum m, GLint f, GLsizei c) { if (recording) { op(GLStream::DRAW_ARRAYS); put<uint32_t>(m); put<int32_t>(f); put<int32_t>(c); } real.DrawArrays(m, f, c); }
+    static void APIENTRY DrawElements(GLenum m, GLsizei c, GLenum t, const void *i) { if (recording) { op(GLStream::DRAW_ELEMENTS); put<uint32_t>(m); put<int32_t>(c); put<uint32_t>(t); put<uint64_t>((uint64_t)(uintptr_t)i); } real.DrawElements(m, c, t, i); }
+    static void APIENTRY DrawArraysInstanced(GLenum m, GLint f, GLsizei c, GLsizei n) { if (recording) { op(GLStream::DRAW_ARRAYS_INSTANCED); put<uint32_t>(m); put<int32_t>(f); put<int32_t>(c); put<int32_t>(n); } real.DrawArraysInstanced(m, f, c, n); }
+    static void APIENTRY DrawElementsInstanced(GLenum m, GLsizei c, GLenum t, const void *i, GLsizei n) { if (recording) { op(GLStream::DRAW_ELEMENTS_INSTANCED); put<uint32_t>(m); put<int32_t>(c); put<uint32_t>(t); put<uint64_t>((uint64_t)(uintptr_t)i); put<int32_t>(n); } real.DrawElementsInstanced(m, c, t, i, n); }
+};
+
+// Re-executes a capture. Captured names are mapped to names generated on this context, the
+// captured default framebuffer is mapped to defaultFramebuffer (the offscreen target).
+class GLReplay
+{
+public:
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            std::cout << "ERROR::GLREPLAY::CANNOT_READ: " << path << std::endl;
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (data.size() < 8 || std::memcmp(data.data(), GLStream::MAGIC, 4) != 0)
+        {
+            std::cout << "ERROR::GLREPLAY::NOT_A_CAPTURE: " << path << std::endl;
+            return false;
+        }
+        cursor = 4;
+        if (get<uint32_t>() != GLStream::VERSION)
+        {
+            std::cout << "ERROR::GLREPLAY::UNSUPPORTED_VERSION: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // executes records up to and including the next frame boundary, false once the stream ends
+    bool playFrame(GLuint defaultFramebuffer)
+    {
+        while (cursor < data.size())
+        {
+            size_t start = cursor;
+            uint16_t code = get<uint16_t>();
+            bool known = corrupt || code == GLStream::END_FRAME || execute(code, defaultFramebuffer);
+            if (corrupt)
+            {
+                std::cout << "ERROR::GLREPLAY::CORRUPT_RECORD: op " << code << " at byte " << start << std::endl;
+                return false;
+            }
+            if (code == GLStream::END_FRAME)
+                return true;
+            if (!known)
+            {
+                std::cout << "ERROR::GLREPLAY::UNKNOWN_OP: " << code << std::endl;
+                return fail();
+            }
+        }
+        return false;
+    }
+
+    // whether playback stopped at a record it couldn't read, a truncated or corrupt capture
+    bool failed() const
+    {
+        return corrupt;
+    }
+
+private:
+    std::vector<char> data;
+    size_t cursor = 0;
+    // set once a record runs past the end of the data or contradicts itself, nothing after it
+    // can be trusted
+    bool corrupt = false;
+
+    std::unordered_map<GLuint, GLuint> buffers, vertexArrays, textures, framebuffers, renderbuffers, shaders, programs;
+    // (replayed program << 32 | captured location) -> replayed location
+    std::unordered_map<uint64_t, GLint> locations;
+    // (replayed program << 32 | captured block index) -> replayed block index
+    std::unordered_map<uint64_t, GLuint> blockIndices;
+    GLuint currentProgram = 0;
+    GLint unpackAlignment = 4;
+
+    // reads a field, or returns zero and marks the stream corrupt when it doesn't fit
+    template <typename T>
+    T get()
+    {
+        T value{};
+        if (!fits(sizeof(T)))
+            return value;
+        std::memcpy(&value, data.data() + cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    bool fits(size_t bytes)
+    {
+        if (!corrupt && bytes <= data.size() - cursor)
+            return true;
+        return fail();
+    }
+
+    bool fail()
+    {
+        corrupt = true;
+        cursor = data.size();
+        return false;
+    }
+
+    // returns the payload in place and skips over it, nullptr when it doesn't fit
+    const char* payload(uint32_t &size)
+    {
+        size = get<uint32_t>();
+        if (!fits(size))
+        {
+            size = 0;
+            return nullptr;
+        }
+        const char *bytes = data.data() + cursor;
+        cursor += size;
+        return bytes;
+    }
+
+    static GLuint mapped(const std::unordered_map<GLuint, GLuint> &map, GLuint name)
+    {
+        if (name == 0)
+            return 0;
+        auto it = map.find(name);
+        return it == map.end() ? 0 : it->second;
+    }
+
+    GLint location(GLint captured)
+    {
+        if (captured < 0)
+            return -1;
+        auto it = locations.find((uint64_t)currentProgram << 32 | (uint32_t)captured);
+        return it == locations.end() ? -1 : it->second;
+    }
+
+    template <typename Gen>
+    void generate(std::unordered_map<GLuint, GLuint> &map, Gen gen)
+    {
+        int32_t n = get<int32_t>();
+        if (n < 0 || (size_t)n > (data.size() - cursor) / sizeof(uint32_t))
+        {
+            fail();
+            return;
+        }
+        std::vector<GLuint> generated(n);
+        gen(n, generated.data());
+        for (int32_t i = 0; i < n; i++)
+            map[get<uint32_t>()] = generated[i];
+    }
+
+    template <typename Del>
+    void remove(std::unordered_map<GLuint, GLuint> &map, Del del)
+    {
+        int32_t n = get<int32_t>();
+        if (n < 0 || (size_t)n > (data.size() - cursor) / sizeof(uint32_t))
+        {
+            fail();
+            return;
+        }
+        std::vector<GLuint> names(n);
+        for (int32_t i = 0; i < n; i++)
+        {
+            GLuint captured = get<uint32_t>();
+            names[i] = mapped(map, captured);
+            map.erase(captured);
+        }
+        del(n, names.data());
+    }
+
+    bool execute(uint16_t code, GLuint defaultFramebuffer)
+    {
+        uint32_t size = 0;
+        switch (code)
+        {
+            case GLStream::GEN_BUFFERS: generate(buffers, glGenBuffers); break;
+            case GLStream::GEN_VERTEX_ARRAYS: generate(vertexArrays, glGenVertexArrays); break;
+            case GLStream::GEN_TEXTURES: generate(textures, glGenTextures); break;
+            case GLStream::GEN_FRAMEBUFFERS: generate(framebuffers, glGenFramebuffers); break;
+            case GLStream::GEN_RENDERBUFFERS: generate(renderbuffers, glGenRenderbuffers); break;
+            case GLStream::CREATE_SHADER: { GLenum type = get<uint32_t>(); shaders[get<uint32_t>()] = glCreateShader(type); break; }
+            case GLStream::CREATE_PROGRAM: programs[get<uint32_t>()] = glCreateProgram(); break;
+            case GLStream::DELETE_BUFFERS: remove(buffers, glDeleteBuffers); break;
+            case GLStream::DELETE_VERTEX_ARRAYS: remove(vertexArrays, glDeleteVertexArrays); break;
+            case GLStream::DELETE_TEXTURES: remove(textures, glDeleteTextures); break;
+            case GLStream::DELETE_FRAMEBUFFERS: remove(framebuffers, glDeleteFramebuffers); break;
+            case GLStream::DELETE_RENDERBUFFERS: remove(renderbuffers, glDeleteRenderbuffers); break;
+            case GLStream::DELETE_SHADER: { GLuint s = get<uint32_t>(); glDeleteShader(mapped(shaders, s)); shaders.erase(s); break; }
+            case GLStream::DELETE_PROGRAM: { GLuint p = get<uint32_t>(); glDeleteProgram(mapped(programs, p)); programs.erase(p); break; }
+
+            case GLStream::BIND_BUFFER: { GLenum t = get<uint32_t>(); glBindBuffer(t, mapped(buffers, get<uint32_t>())); break; }
+            case GLStream::BIND_VERTEX_ARRAY: glBindVertexArray(mapped(vertexArrays, get<uint32_t>())); break;
+            case GLStream::BIND_TEXTURE: { GLenum t = get<uint32_t>(); glBindTexture(t, mapped(textures, get<uint32_t>())); break; }
+            case GLStream::ACTIVE_TEXTURE: glActiveTexture(get<uint32_t>()); break;
+            case GLStream::BIND_FRAMEBUFFER:
+            {
+                GLenum t = get<uint32_t>();
+                GLuint f = get<uint32_t>();
+                glBindFramebuffer(t, f == 0 ? defaultFramebuffer : mapped(framebuffers, f));
+                break;
+            }
+            case GLStream::BIND_RENDERBUFFER: { GLenum t = get<uint32_t>(); glBindRenderbuffer(t, mapped(renderbuffers, get<uint32_t>())); break; }
+            case GLStream::USE_PROGRAM: currentProgram = mapped(programs, get<uint32_t>()); glUseProgram(currentProgram); break;
+
+            case GLStream::BUFFER_DATA:
+            {
+                GLenum target = get<uint32_t>();
+                uint64_t bytes = get<uint64_t>();
+                GLenum usage = get<uint32_t>();
+                const char *p = payload(size);
+                if (!p || (size && !holds(size, bytes)))
+                    break;
+                glBufferData(target, (GLsizeiptr)bytes, size ? p : nullptr, usage);
+                break;
+            }
+            case GLStream::BUFFER_SUB_DATA:
+            {
+                GLenum target = get<uint32_t>();
+                uint64_t offset = get<uint64_t>();
+                const char *p = payload(size);
+                if (!p)
+                    break;
+                glBufferSubData(target, (GLintptr)offset, size, p);
+                break;
+            }
+            case GLStream::TEX_IMAGE_2D:
+            {
+                GLenum target = get<uint32_t>(); GLint level = get<int32_t>(); GLint internalFormat = get<int32_t>();
+                GLsizei w = get<int32_t>(); GLsizei h = get<int32_t>(); GLint border = get<int32_t>();
+                GLenum format = get<uint32_t>(); GLenum type = get<uint32_t>();
+                const char *p = payload(size);
+                if (!p || (size && !holds(size, imageBytes(w, h, format, type))))
+                    break;
+                glTexImage2D(target, level, internalFormat, w, h, border, format, type, size ? p : nullptr);
+                break;
+            }
+            case GLStream::TEX_SUB_IMAGE_2D:
+            {
+                GLenum target = get<uint32_t>(); GLint level = get<int32_t>(); GLint x = get<int32_t>(); GLint y = get<int32_t>();
+                GLsizei w = get<int32_t>(); GLsizei h = get<int32_t>(); GLenum format = get<uint32_t>(); GLenum type = get<uint32_t>();
+                const char *p = payload(size);
+                if (!p || !holds(size, imageBytes(w, h, format, type)))
+                    break;
+                glTexSubImage2D(target, level, x, y, w, h, format, type, p);
+                break;
+            }
+            case GLStream::TEX_PARAMETERI: { GLenum t = get<uint32_t>(); GLenum p = get<uint32_t>(); glTexParameteri(t, p, get<int32_t>()); break; }
+            case GLStream::GENERATE_MIPMAP: glGenerateMipmap(get<uint32_t>()); break;
+            case GLStream::PIXEL_STOREI:
+            {
+                GLenum p = get<uint32_t>(); GLint v = get<int32_t>();
+                if (p == GL_UNPACK_ALIGNMENT && (v == 1 || v == 2 || v == 4 || v == 8))
+                    unpackAlignment = v;
+                glPixelStorei(p, v);
+                break;
+            }
+            case GLStream::RENDERBUFFER_STORAGE:
+            {
+                GLenum t = get<uint32_t>(); GLenum f = get<uint32_t>(); GLsizei w = get<int32_t>(); GLsizei h = get<int32_t>();
+                glRenderbufferStorage(t, f, w, h);
+                break;
+            }
+            case GLStream::FRAMEBUFFER_RENDERBUFFER:
+            {
+                GLenum t = get<uint32_t>(); GLenum a = get<uint32_t>(); GLenum rt = get<uint32_t>();
+                glFramebufferRenderbuffer(t, a, rt, mapped(renderbuffers, get<uint32_t>()));
+                break;
+            }
+            case GLStream::FRAMEBUFFER_TEXTURE_2D:
+            {
+                GLenum t = get<uint32_t>(); GLenum a = get<uint32_t>(); GLenum tt = get<uint32_t>();
+                GLuint x = mapped(textures, get<uint32_t>());
+                glFramebufferTexture2D(t, a, tt, x, get<int32_t>());
+                break;
+            }
+
+            case GLStream::VERTEX_ATTRIB_POINTER:
+            {
+                GLuint i = get<uint32_t>(); GLint s = get<int32_t>(); GLenum t = get<uint32_t>();
+                GLboolean n = get<uint8_t>(); GLsizei stride = get<int32_t>(); uint64_t offset = get<uint64_t>();
+                glVertexAttribPointer(i, s, t, n, stride, (const void*)(uintptr_t)offset);
+                break;
+            }
+            case GLStream::VERTEX_ATTRIB_I_POINTER:
+            {
+                GLuint i = get<uint32_t>(); GLint s = get<int32_t>(); GLenum t = get<uint32_t>();
+                GLsizei stride = get<int32_t>(); uint64_t offset = get<uint64_t>();
+                glVertexAttribIPointer(i, s, t, stride, (const void*)(uintptr_t)offset);
+                break;
+            }
+            case GLStream::ENABLE_VERTEX_ATTRIB_ARRAY: glEnableVertexAttribArray(get<uint32_t>()); break;
+
+            case GLStream::SHADER_SOURCE:
+            {
+                GLuint s = mapped(shaders, get<uint32_t>());
+                const GLchar *p = payload(size);
+                if (!p)
+                    break;
+                GLint length = (GLint)size;
+                glShaderSource(s, 1, &p, &length);
+                break;
+            }
+            case GLStream::COMPILE_SHADER: glCompileShader(mapped(shaders, get<uint32_t>())); break;
+            case GLStream::ATTACH_SHADER: { GLuint p = mapped(programs, get<uint32_t>()); glAttachShader(p, mapped(shaders, get<uint32_t>())); break; }
+            case GLStream::DETACH_SHADER: { GLuint p = mapped(programs, get<uint32_t>()); glDetachShader(p, mapped(shaders, get<uint32_t>())); break; }
+            case GLStream::LINK_PROGRAM: glLinkProgram(mapped(programs, get<uint32_t>())); break;
+            case GLStream::GET_UNIFORM_LOCATION:
+            {
+                GLuint program = mapped(programs, get<uint32_t>());
+                GLint captured = get<int32_t>();
+                const char *p = payload(size);
+                if (!p)
+                    break;
+                std::string name(p, size);
+                if (captured >= 0)
+                    locations[(uint64_t)program << 32 | (uint32_t)captured] = glGetUniformLocation(program, name.c_str());
+                break;
+            }
+            case GLStream::GET_UNIFORM_BLOCK_INDEX:
+            {
+                GLuint program = mapped(programs, get<uint32_t>());
+                GLuint captured = get<uint32_t>();
+                const char *p = payload(size);
+                if (!p)
+                    break;
+                std::string name(p, size);
+                if (captured != GL_INVALID_INDEX)
+                    blockIndices[(uint64_t)program << 32 | captured] = glGetUniformBlockIndex(program, name.c_str());
+                break;
+            }
+            case GLStream::UNIFORM_BLOCK_BINDING:
+            {
+                GLuint program = mapped(programs, get<uint32_t>());
+                auto it = blockIndices.find((uint64_t)program << 32 | get<uint32_t>());
+                GLuint binding = get<uint32_t>();
+                if (it != blockIndices.end() && it->second != GL_INVALID_INDEX)
+                    glUniformBlockBinding(program, it->second, binding);
+                break;
+            }
+            case GLStream::BIND_BUFFER_RANGE:
+            {
+                GLenum t = get<uint32_t>(); GLuint i = get<uint32_t>(); GLuint b = mapped(buffers, get<uint32_t>());
+                uint64_t offset = get<uint64_t>();
+                glBindBufferRange(t, i, b, (GLintptr)offset, (GLsizeiptr)get<uint64_t>());
+                break;
+            }
+
+            case GLStream::UNIFORM_1I: { GLint l = location(get<int32_t>()); glUniform1i(l, get<int32_t>()); break; }
+            case GLStream::UNIFORM_1F: { GLint l = location(get<int32_t>()); glUniform1f(l, get<float>()); break; }
+            case GLStream::UNIFORM_2F: { GLint l = location(get<int32_t>()); float x = get<float>(); glUniform2f(l, x, get<float>()); break; }
+            case GLStream::UNIFORM_3F: { GLint l = location(get<int32_t>()); float x = get<float>(); float y = get<float>(); glUniform3f(l, x, y, get<float>()); break; }
+            case GLStream::UNIFORM_4F:
+            {
+                GLint l = location(get<int32_t>());
+                float x = get<float>(); float y = get<float>(); float z = get<float>();
+                glUniform4f(l, x, y, z, get<float>());
+                break;
+            }
+            case GLStream::UNIFORM_2FV: case GLStream::UNIFORM_3FV: case GLStream::UNIFORM_4FV:
+            {
+                GLint l = location(get<int32_t>());
+                GLsizei n = get<int32_t>();
+                std::vector<GLfloat> v(payloadFloats(size));
+                int components = code == GLStream::UNIFORM_2FV ? 2 : code == GLStream::UNIFORM_3FV ? 3 : 4;
+                if (!counted(n, components, v))
+                    break;
+                if (code == GLStream::UNIFORM_2FV) glUniform2fv(l, n, v.data());
+                else if (code == GLStream::UNIFORM_3FV) glUniform3fv(l, n, v.data());
+                else glUniform4fv(l, n, v.data());
+                break;
+            }
+            case GLStream::UNIFORM_MATRIX_2FV: case GLStream::UNIFORM_MATRIX_3FV: case GLStream::UNIFORM_MATRIX_4FV:
+            {
+                GLint l = location(get<int32_t>());
+                GLsizei n = get<int32_t>();
+                std::vector<GLfloat> v(payloadFloats(size));
+                GLboolean t = get<uint8_t>();
+                int components = code == GLStream::UNIFORM_MATRIX_2FV ? 4 : code == GLStream::UNIFORM_MATRIX_3FV ? 9 : 16;
+                if (!counted(n, components, v))
+                    break;
+                if (code == GLStream::UNIFORM_MATRIX_2FV) glUniformMatrix2fv(l, n, t, v.data());
+                else if (code == GLStream::UNIFORM_MATRIX_3FV) glUniformMatrix3fv(l, n, t, v.data());
+                else glUniformMatrix4fv(l, n, t, v.data());
+                break;
+            }
+
+            case GLStream::ENABLE: glEnable(get<uint32_t>()); break;
+            case GLStream::DISABLE: glDisable(get<uint32_t>()); break;
+            case GLStream::DEPTH_FUNC: glDepthFunc(get<uint32_t>()); break;
+            case GLStream::DEPTH_MASK: glDepthMask(get<uint8_t>()); break;
+            case GLStream::COLOR_MASK:
+            {
+                GLboolean r = get<uint8_t>(); GLboolean g = get<uint8_t>(); GLboolean b = get<uint8_t>();
+                glColorMask(r, g, b, get<uint8_t>());
+                break;
+            }
+            case GLStream::BLEND_FUNC: { GLenum s = get<uint32_t>(); glBlendFunc(s, get<uint32_t>()); break; }
+            case GLStream::VIEWPORT: case GLStream::SCISSOR:
+            {
+                GLint x = get<int32_t>(); GLint y = get<int32_t>(); GLsizei w = get<int32_t>(); GLsizei h = get<int32_t>();
+                if (code == GLStream::VIEWPORT) glViewport(x, y, w, h);
+                else glScissor(x, y, w, h);
+                break;
+            }
+            case GLStream::POLYGON_MODE: { GLenum f = get<uint32_t>(); glPolygonMode(f, get<uint32_t>()); break; }
+            case GLStream::CLEAR_COLOR:
+            {
+                float r = get<float>(); float g = get<float>(); float b = get<float>();
+                glClearColor(r, g, b, get<float>());
+                break;
+            }
+            case GLStream::CLEAR: glClear(get<uint32_t>()); break;
+
+            case GLStream::DRAW_ARRAYS: { GLenum m = get<uint32_t>(); GLint f = get<int32_t>(); glDrawArrays(m, f, get<int32_t>()); break; }
+            case GLStream::DRAW_ELEMENTS:
+            {
+                GLenum m = get<uint32_t>(); GLsizei c = get<int32_t>(); GLenum t = get<uint32_t>(); uint64_t offset = get<uint64_t>();
+                glDrawElements(m, c, t, (const void*)(uintptr_t)offset);
+                break;
+            }
+            case GLStream::DRAW_ARRAYS_INSTANCED:
+            {
+                GLenum m = get<uint32_t>(); GLint f = get<int32_t>(); GLsizei c = get<int32_t>();
+                glDrawArraysInstanced(m, f, c, get<int32_t>());
+                break;
+            }
+            case GLStream::DRAW_ELEMENTS_INSTANCED:
+            {
+                GLenum m = get<uint32_t>(); GLsizei c = get<int32_t>(); GLenum t = get<uint32_t>(); uint64_t offset = get<uint64_t>();
+                glDrawElementsInstanced(m, c, t, (const void*)(uintptr_t)offset, get<int32_t>());
+                break;
+            }
+            default:
+                return false;
+        }
+        return true;
+    }
+
+    // copies a float payload out, the stream has no alignment guarantees
+    std::vector<GLfloat> payloadFloats(uint32_t &size)
+    {
+        const char *p = payload(size);
+        std::vector<GLfloat> v(size / sizeof(GLfloat));
+        if (p && !v.empty())
+            std::memcpy(v.data(), p, v.size() * sizeof(GLfloat));
+        return v;
+    }
+
+    // whether a payload holds the bytes GL will read from it for the record's sizes
+    bool holds(uint32_t size, uint64_t expected)
+    {
+        return (!corrupt && size >= expected) || fail();
+    }
+
+    uint64_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) const
+    {
+        if (width < 0 || height < 0)
+            return UINT64_MAX;
+        uint64_t row = (uint64_t)width * GLCounters::pixelBytes(format, type);
+        row = (row + unpackAlignment - 1) / unpackAlignment * unpackAlignment;
+        return row * height;
+    }
+
+    // whether a float payload holds the count values of components the record claims, a corrupt
+    // count would have GL read past it
+    bool counted(GLsizei count, int components, const std::vector<GLfloat> &v)
+    {
+        if (corrupt)
+            return false;
+        if (count >= 0 && (size_t)count * components <= v.size())
+            return true;
+        return fail();
+    }
+};
+#endif
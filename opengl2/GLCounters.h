@@ -0,0 +1,509 @@
+#ifndef GL_COUNTERS_H
+#define GL_COUNTERS_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+// Opt-in interception of the GL entry points glad loaded. install() swaps the glad_gl* pointers
+// (and the glExt program uniform pointers) for wrappers that count what the app submits and then
+// call the driver. Nothing is wrapped until install() is called, so the normal path pays nothing.
+//
+// Redundant binds are binds of the object that is already bound, tracked for programs, vertex
+// arrays, 2D textures per unit, buffers (except GL_ELEMENT_ARRAY_BUFFER, which is VAO state) and
+// framebuffers. The tracking assumes every call goes through the wrappers, i.e. install() runs
+// right after the context is created.
+
+struct GLFrameCounters
+{
+    uint64_t drawCalls = 0;
+    uint64_t triangles = 0;
+    // state changes by category
+    uint64_t programBinds = 0;
+    uint64_t vertexArrayBinds = 0;
+    uint64_t textureBinds = 0;      // glBindTexture and glActiveTexture
+    uint64_t bufferBinds = 0;
+    uint64_t framebufferBinds = 0;
+    uint64_t fixedFunction = 0;     // enable/disable, depth, color mask, blend, viewport, scissor
+    uint64_t redundantBinds = 0;
+    uint64_t uniformUploads = 0;
+    uint64_t uniformLookups = 0;    // glGetUniformLocation
+    uint64_t bufferUploadBytes = 0;
+    uint64_t textureUploadBytes = 0;
+    // one-off work that tends to cause hitches
+    uint64_t shaderCompiles = 0;
+    uint64_t programLinks = 0;
+    uint64_t textureUploads = 0;     // glTexImage2D and glTexSubImage2D calls
+    uint64_t bufferAllocations = 0;  // glBufferData calls, each (re)allocates the store
+    uint64_t bufferAllocationBytes = 0;
+};
+
+class GLCounters
+{
+public:
+    // call after gladLoadGLLoader and loadGLExtensions, before anything is bound
+    static void install()
+    {
+        if (installed)
+            return;
+        installed = true;
+        wrap(glad_glDrawArrays, real.DrawArrays, &DrawArrays);
+        wrap(glad_glDrawElements, real.DrawElements, &DrawElements);
+        wrap(glad_glDrawArraysInstanced, real.DrawArraysInstanced, &DrawArraysInstanced);
+        wrap(glad_glDrawElementsInstanced, real.DrawElementsInstanced, &DrawElementsInstanced);
+        wrap(glad_glUseProgram, real.UseProgram, &UseProgram);
+        wrap(glad_glBindVertexArray, real.BindVertexArray, &BindVertexArray);
+        wrap(glad_glActiveTexture, real.ActiveTexture, &ActiveTexture);
+        wrap(glad_glBindTexture, real.BindTexture, &BindTexture);
+        wrap(glad_glBindBuffer, real.BindBuffer, &BindBuffer);
+        wrap(glad_glBindBufferRange, real.BindBufferRange, &BindBufferRange);
+        wrap(glad_glBindFramebuffer, real.BindFramebuffer, &BindFramebuffer);
+        wrap(glad_glDeleteProgram, real.DeleteProgram, &DeleteProgram);
+        wrap(glad_glDeleteVertexArrays, real.DeleteVertexArrays, &DeleteVertexArrays);
+        wrap(glad_glDeleteTextures, real.DeleteTextures, &DeleteTextures);
+        wrap(glad_glDeleteBuffers, real.DeleteBuffers, &DeleteBuffers);
+        wrap(glad_glDeleteFramebuffers, real.DeleteFramebuffers, &DeleteFramebuffers);
+        wrap(glad_glEnable, real.Enable, &Enable);
+        wrap(glad_glDisable, real.Disable, &Disable);
+        wrap(glad_glDepthFunc, real.DepthFunc, &DepthFunc);
+        wrap(glad_glDepthMask, real.DepthMask, &DepthMask);
+        wrap(glad_glColorMask, real.ColorMask, &ColorMask);
+        wrap(glad_glBlendFunc, real.BlendFunc, &BlendFunc);
+        wrap(glad_glViewport, real.Viewport, &Viewport);
+        wrap(glad_glScissor, real.Scissor, &Scissor);
+        wrap(glad_glGetUniformLocation, real.GetUniformLocation, &GetUniformLocation);
+        wrap(glad_glUniform1i, real.Uniform1i, &Uniform1i);
+        wrap(glad_glUniform1f, real.Uniform1f, &Uniform1f);
+        wrap(glad_glUniform2f, real.Uniform2f, &Uniform2f);
+        wrap(glad_glUniform3f, real.Uniform3f, &Uniform3f);
+        wrap(glad_glUniform4f, real.Uniform4f, &Uniform4f);
+        wrap(glad_glUniform2fv, real.Uniform2fv, &Uniform2fv);
+        wrap(glad_glUniform3fv, real.Uniform3fv, &Uniform3fv);
+        wrap(glad_glUniform4fv, real.Uniform4fv, &Uniform4fv);
+        wrap(glad_glUniformMatrix2fv, real.UniformMatrix2fv, &UniformMatrix2fv);
+        wrap(glad_glUniformMatrix3fv, real.UniformMatrix3fv, &UniformMatrix3fv);
+        wrap(glad_glUniformMatrix4fv, real.UniformMatrix4fv, &UniformMatrix4fv);
+        wrap(glad_glBufferData, real.BufferData, &BufferData);
+        wrap(glad_glBufferSubData, real.BufferSubData, &BufferSubData);
+        wrap(glad_glTexImage2D, real.TexImage2D, &TexImage2D);
+        wrap(glad_glTexSubImage2D, real.TexSubImage2D, &TexSubImage2D);
+        wrap(glad_glCompileShader, real.CompileShader, &CompileShader);
+        wrap(glad_glLinkProgram, real.LinkProgram, &LinkProgram);
+        if (glExt.separateShaderObjects)
+        {
+            wrap(glExt.BindProgramPipeline, real.BindProgramPipeline, &BindProgramPipeline);
+            wrap(glExt.ProgramUniform1i, real.ProgramUniform1i, &ProgramUniform1i);
+            wrap(glExt.ProgramUniform1f, real.ProgramUniform1f, &ProgramUniform1f);
+            wrap(glExt.ProgramUniform2f, real.ProgramUniform2f, &ProgramUniform2f);
+            wrap(glExt.ProgramUniform3f, real.ProgramUniform3f, &ProgramUniform3f);
+            wrap(glExt.ProgramUniform4f, real.ProgramUniform4f, &ProgramUniform4f);
+            wrap(glExt.ProgramUniform2fv, real.ProgramUniform2fv, &ProgramUniform2fv);
+            wrap(glExt.ProgramUniform3fv, real.ProgramUniform3fv, &ProgramUniform3fv);
+            wrap(glExt.ProgramUniform4fv, real.ProgramUniform4fv, &ProgramUniform4fv);
+            wrap(glExt.ProgramUniformMatrix2fv, real.ProgramUniformMatrix2fv, &ProgramUniformMatrix2fv);
+            wrap(glExt.ProgramUniformMatrix3fv, real.ProgramUniformMatrix3fv, &ProgramUniformMatrix3fv);
+            wrap(glExt.ProgramUniformMatrix4fv, real.ProgramUniformMatrix4fv, &ProgramUniformMatrix4fv);
+        }
+    }
+
+    static bool isInstalled()
+    {
+        return installed;
+    }
+
+    // counts so far in the current frame
+    static const GLFrameCounters& current()
+    {
+        return counters;
+    }
+
+    // counts of the last frame closed with endFrame()
+    static const GLFrameCounters& lastFrame()
+    {
+        return last;
+    }
+
+    // every following endFrame() appends one row to path
+    static bool openCsv(const std::string &path)
+    {
+        csv.open(path);
+        if (!csv)
+        {
+            std::cout << "ERROR::GLCOUNTERS::CANNOT_WRITE_CSV: " << path << std::endl;
+            return false;
+        }
+        csv << "frame,draw_calls,triangles,program_binds,vertex_array_binds,texture_binds,buffer_binds,"
+               "framebuffer_binds,fixed_function,redundant_binds,uniform_uploads,uniform_lookups,"
+               "buffer_upload_bytes,texture_upload_bytes,shader_compiles,program_links,texture_uploads,"
+               "buffer_allocations,buffer_allocation_bytes\n";
+        return true;
+    }
+
+    static void endFrame()
+    {
+        if (!installed)
+            return;
+        if (csv.is_open())
+        {
+            const GLFrameCounters &c = counters;
+            csv << frameNumber << ',' << c.drawCalls << ',' << c.triangles << ',' << c.programBinds << ','
+                << c.vertexArrayBinds << ',' << c.textureBinds << ',' << c.bufferBinds << ','
+                << c.framebufferBinds << ',' << c.fixedFunction << ',' << c.redundantBinds << ','
+                << c.uniformUploads << ',' << c.uniformLookups << ',' << c.bufferUploadBytes << ','
+                << c.textureUploadBytes << ',' << c.shaderCompiles << ',' << c.programLinks << ','
+                << c.textureUploads << ',' << c.bufferAllocations << ',' << c.bufferAllocationBytes << '\n';
+        }
+        last = counters;
+        counters = GLFrameCounters();
+        frameNumber++;
+    }
+
+    static void closeCsv()
+    {
+        if (csv.is_open())
+            csv.close();
+    }
+
+    // bytes per pixel of client pixel data in format/type, ignoring row alignment
+    static uint64_t pixelBytes(GLenum format, GLenum type)
+    {
+        switch (type)
+        {
+            case GL_UNSIGNED_INT_24_8:
+            case GL_UNSIGNED_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_10F_11F_11F_REV:
+                return 4;
+            case GL_UNSIGNED_SHORT_5_6_5:
+            case GL_UNSIGNED_SHORT_4_4_4_4:
+            case GL_UNSIGNED_SHORT_5_5_5_1:
+                return 2;
+        }
+        uint64_t components = 4;
+        switch (format)
+        {
+            case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: components = 1; break;
+            case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL: components = 2; break;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+        }
+        uint64_t size = 1;
+        if (type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT)
+            size = 4;
+        else if (type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT)
+            size = 2;
+        return components * size;
+    }
+
+private:
+    struct Real
+    {
+        PFNGLDRAWARRAYSPROC DrawArrays;
+        PFNGLDRAWELEMENTSPROC DrawElements;
+        PFNGLDRAWARRAYSINSTANCEDPROC DrawArraysInstanced;
+        PFNGLDRAWELEMENTSINSTANCEDPROC DrawElementsInstanced;
+        PFNGLUSEPROGRAMPROC UseProgram;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+        PFNGLACTIVETEXTUREPROC ActiveTexture;
+        PFNGLBINDTEXTUREPROC BindTexture;
+        PFNGLBINDBUFFERPROC BindBuffer;
+        PFNGLBINDBUFFERRANGEPROC BindBufferRange;
+        PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+        PFNGLDELETEPROGRAMPROC DeleteProgram;
+        PFNGLDELETEVERTEXARRAYSPROC DeleteVertexArrays;
+        PFNGLDELETETEXTURESPROC DeleteTextures;
+        PFNGLDELETEBUFFERSPROC DeleteBuffers;
+        PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+        PFNGLENABLEPROC Enable;
+        PFNGLDISABLEPROC Disable;
+        PFNGLDEPTHFUNCPROC DepthFunc;
+        PFNGLDEPTHMASKPROC DepthMask;
+        PFNGLCOLORMASKPROC ColorMask;
+        PFNGLBLENDFUNCPROC BlendFunc;
+        PFNGLVIEWPORTPROC Viewport;
+        PFNGLSCISSORPROC Scissor;
+        PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+        PFNGLUNIFORM1IPROC Uniform1i;
+        PFNGLUNIFORM1FPROC Uniform1f;
+        PFNGLUNIFORM2FPROC Uniform2f;
+        PFNGLUNIFORM3FPROC Uniform3f;
+        PFNGLUNIFORM4FPROC Uniform4f;
+        PFNGLUNIFORM2FVPROC Uniform2fv;
+        PFNGLUNIFORM3FVPROC Uniform3fv;
+        PFNGLUNIFORM4FVPROC Uniform4fv;
+        PFNGLUNIFORMMATRIX2FVPROC UniformMatrix2fv;
+        PFNGLUNIFORMMATRIX3FVPROC UniformMatrix3fv;
+        PFNGLUNIFORMMATRIX4FVPROC UniformMatrix4fv;
+        PFNGLBUFFERDATAPROC BufferData;
+        PFNGLBUFFERSUBDATAPROC BufferSubData;
+        PFNGLTEXIMAGE2DPROC TexImage2D;
+        PFNGLTEXSUBIMAGE2DPROC TexSubImage2D;
+        PFNGLCOMPILESHADERPROC CompileShader;
+        PFNGLLINKPROGRAMPROC LinkProgram;
+        PFNBINDPROGRAMPIPELINE BindProgramPipeline;
+        PFNPROGRAMUNIFORM1I ProgramUniform1i;
+        PFNPROGRAMUNIFORM1F ProgramUniform1f;
+        PFNPROGRAMUNIFORM2F ProgramUniform2f;
+        PFNPROGRAMUNIFORM3F ProgramUniform3f;
+        PFNPROGRAMUNIFORM4F ProgramUniform4f;
+        PFNPROGRAMUNIFORMFV ProgramUniform2fv;
+        PFNPROGRAMUNIFORMFV ProgramUniform3fv;
+        PFNPROGRAMUNIFORMFV ProgramUniform4fv;
+        PFNPROGRAMUNIFORMMATRIXFV ProgramUniformMatrix2fv;
+        PFNPROGRAMUNIFORMMATRIXFV ProgramUniformMatrix3fv;
+        PFNPROGRAMUNIFORMMATRIXFV ProgramUniformMatrix4fv;
+    };
+
+    inline static bool installed = false;
+    inline static Real real{};
+    inline static GLFrameCounters counters;
+    inline static GLFrameCounters last;
+    inline static std::ofstream csv;
+    inline static uint64_t frameNumber = 0;
+
+    // bound object tracking for redundant binds
+    inline static GLuint program = 0;
+    inline static GLuint pipeline = 0;
+    inline static GLuint vertexArray = 0;
+    inline static GLuint activeUnit = 0;
+    inline static std::array<GLuint, 32> textures2D{};
+    inline static std::unordered_map<GLenum, GLuint> buffers;
+    inline static GLuint drawFramebuffer = 0;
+    inline static GLuint readFramebuffer = 0;
+    template <typename Fn>
+    static void wrap(Fn &slot, Fn &saved, Fn wrapper)
+    {
+        saved = slot;
+        if (slot)
+            slot = wrapper;
+    }
+
+    // true (and counted) when name is already bound
+    static bool redundant(GLuint &bound, GLuint name)
+    {
+        if (bound == name)
+        {
+            counters.redundantBinds++;
+            return true;
+        }
+        bound = name;
+        return false;
+    }
+
+    static uint64_t trianglesFor(GLenum mode, GLsizei count)
+    {
+        if (mode == GL_TRIANGLES)
+            return count / 3;
+        if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN)
+            return count > 2 ? count - 2 : 0;
+        return 0;
+    }
+
+    // draws
+    static void APIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+        counters.drawCalls++;
+        counters.triangles += trianglesFor(mode, count);
+        real.DrawArrays(mode, first, count);
+    }
+    static void APIENTRY DrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+    {
+        counters.drawCalls++;
+        counters.triangles += trianglesFor(mode, count);
+        real.DrawElements(mode, count, type, indices);
+    }
+    static void APIENTRY DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+    {
+        counters.drawCalls++;
+        counters.triangles += trianglesFor(mode, count) * instances;
+        real.DrawArraysInstanced(mode, first, count, instances);
+    }
+    static void APIENTRY DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances)
+    {
+        counters.drawCalls++;
+        counters.triangles += trianglesFor(mode, count) * instances;
+        real.DrawElementsInstanced(mode, count, type, indices, instances);
+    }
+
+    // binds
+    static void APIENTRY UseProgram(GLuint name)
+    {
+        counters.programBinds++;
+        redundant(program, name);
+        real.UseProgram(name);
+    }
+    static void APIENTRY BindProgramPipeline(GLuint name)
+    {
+        counters.programBinds++;
+        redundant(pipeline, name);
+        real.BindProgramPipeline(name);
+    }
+    static void APIENTRY BindVertexArray(GLuint name)
+    {
+        counters.vertexArrayBinds++;
+        redundant(vertexArray, name);
+        real.BindVertexArray(name);
+    }
+    static void APIENTRY ActiveTexture(GLenum unit)
+    {
+        counters.textureBinds++;
+        GLuint index = unit - GL_TEXTURE0;
+        redundant(activeUnit, std::min<GLuint>(index, (GLuint)textures2D.size() - 1));
+        real.ActiveTexture(unit);
+    }
+    static void APIENTRY BindTexture(GLenum target, GLuint name)
+    {
+        counters.textureBinds++;
+        if (target == GL_TEXTURE_2D)
+            redundant(textures2D[activeUnit], name);
+        real.BindTexture(target, name);
+    }
+    static void APIENTRY BindBuffer(GLenum target, GLuint name)
+    {
+        counters.bufferBinds++;
+        if (target != GL_ELEMENT_ARRAY_BUFFER)
+            redundant(buffers[target], name);
+        real.BindBuffer(target, name);
+    }
+    // a range of a uniform block buffer per draw is what replaces its glUniform* calls, so it's a
+    // bind every time. It also binds the buffer to the generic target.
+    static void APIENTRY BindBufferRange(GLenum target, GLuint index, GLuint name, GLintptr offset, GLsizeiptr size)
+    {
+        counters.bufferBinds++;
+        buffers[target] = name;
+        real.BindBufferRange(target, index, name, offset, size);
+    }
+    static void APIENTRY BindFramebuffer(GLenum target, GLuint name)
+    {
+        counters.framebufferBinds++;
+        if (target == GL_READ_FRAMEBUFFER)
+            redundant(readFramebuffer, name);
+        else if (target == GL_DRAW_FRAMEBUFFER)
+            redundant(drawFramebuffer, name);
+        else
+        {
+            // GL_FRAMEBUFFER binds both targets
+            if (drawFramebuffer == name && readFramebuffer == name)
+                counters.redundantBinds++;
+            drawFramebuffer = readFramebuffer = name;
+        }
+        real.BindFramebuffer(target, name);
+    }
+
+    // deleting a bound object unbinds it, a new object may then reuse the name
+    static void APIENTRY DeleteProgram(GLuint name)
+    {
+        if (program == name)
+            program = 0;
+        real.DeleteProgram(name);
+    }
+    static void APIENTRY DeleteVertexArrays(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+            if (vertexArray == names[i])
+                vertexArray = 0;
+        real.DeleteVertexArrays(n, names);
+    }
+    static void APIENTRY DeleteTextures(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+            std::replace(textures2D.begin(), textures2D.end(), names[i], 0u);
+        real.DeleteTextures(n, names);
+    }
+    static void APIENTRY DeleteBuffers(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+            for (auto &binding : buffers)
+                if (binding.second == names[i])
+                    binding.second = 0;
+        real.DeleteBuffers(n, names);
+    }
+    static void APIENTRY DeleteFramebuffers(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+        {
+            if (drawFramebuffer == names[i])
+                drawFramebuffer = 0;
+            if (readFramebuffer == names[i])
+                readFramebuffer = 0;
+        }
+        real.DeleteFramebuffers(n, names);
+    }
+
+    // fixed function state
+    static void APIENTRY Enable(GLenum cap) { counters.fixedFunction++; real.Enable(cap); }
+    static void APIENTRY Disable(GLenum cap) { counters.fixedFunction++; real.Disable(cap); }
+    static void APIENTRY DepthFunc(GLenum func) { counters.fixedFunction++; real.DepthFunc(func); }
+    static void APIENTRY DepthMask(GLboolean flag) { counters.fixedFunction++; real.DepthMask(flag); }
+    static void APIENTRY ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) { counters.fixedFunction++; real.ColorMask(r, g, b, a); }
+    static void APIENTRY BlendFunc(GLenum src, GLenum dst) { counters.fixedFunction++; real.BlendFunc(src, dst); }
+    static void APIENTRY Viewport(GLint x, GLint y, GLsizei w, GLsizei h) { counters.fixedFunction++; real.Viewport(x, y, w, h); }
+    static void APIENTRY Scissor(GLint x, GLint y, GLsizei w, GLsizei h) { counters.fixedFunction++; real.Scissor(x, y, w, h); }
+
+    // uniforms
+    static GLint APIENTRY GetUniformLocation(GLuint program, const GLchar *name)
+    {
+        counters.uniformLookups++;
+        return real.GetUniformLocation(program, name);
+    }
+    static void APIENTRY Uniform1i(GLint l, GLint v0) { counters.uniformUploads++; real.Uniform1i(l, v0); }
+    static void APIENTRY Uniform1f(GLint l, GLfloat v0) { counters.uniformUploads++; real.Uniform1f(l, v0); }
+    static void APIENTRY Uniform2f(GLint l, GLfloat v0, GLfloat v1) { counters.uniformUploads++; real.Uniform2f(l, v0, v1); }
+    static void APIENTRY Uniform3f(GLint l, GLfloat v0, GLfloat v1, GLfloat v2) { counters.uniformUploads++; real.Uniform3f(l, v0, v1, v2); }
+    static void APIENTRY Uniform4f(GLint l, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { counters.uniformUploads++; real.Uniform4f(l, v0, v1, v2, v3); }
+    static void APIENTRY Uniform2fv(GLint l, GLsizei n, const GLfloat *v) { counters.uniformUploads++; real.Uniform2fv(l, n, v); }
+    static void APIENTRY Uniform3fv(GLint l, GLsizei n, const GLfloat *v) { counters.uniformUploads++; real.Uniform3fv(l, n, v); }
+    static void APIENTRY Uniform4fv(GLint l, GLsizei n, const GLfloat *v) { counters.uniformUploads++; real.Uniform4fv(l, n, v); }
+    static void APIENTRY UniformMatrix2fv(GLint l, GLsizei n, GLboolean t, const GLfloat *v) { counters.uniformUploads++; real.UniformMatrix2fv(l, n, t, v); }
+    static void APIENTRY UniformMatrix3fv(GLint l, GLsizei n, GLboolean t, const GLfloat *v) { counters.uniformUploads++; real.UniformMatrix3fv(l, n, t, v); }
+    static void APIENTRY UniformMatrix4fv(GLint l, GLsizei n, GLboolean t, const GLfloat *v) { counters.uniformUploads++; real.UniformMatrix4fv(l, n, t, v); }
+    static void APIENTRY ProgramUniform1i(GLuint p, GLint l, GLint v0) { counters.uniformUploads++; real.ProgramUniform1i(p, l, v0); }
+    static void APIENTRY ProgramUniform1f(GLuint p, GLint l, GLfloat v0) { counters.uniformUploads++; real.ProgramUniform1f(p, l, v0); }
+    static void APIENTRY ProgramUniform2f(GLuint p, GLint l, GLfloat v0, GLfloat v1) { counters.uniformUploads++; real.ProgramUniform2f(p, l, v0, v1); }
+    static void APIENTRY ProgramUniform3f(GLuint p, GLint l, GLfloat v0, GLfloat v1, GLfloat v2) { counters.uniformUploads++; real.ProgramUniform3f(p, l, v0, v1, v2); }
+    static void APIENTRY ProgramUniform4f(GLuint p, GLint l, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { counters.uniformUploads++; real.ProgramUniform4f(p, l, v0, v1, v2, v3); }
+    static void APIENTRY ProgramUniform2fv(GLuint p, GLint l, GLsizei n, const GLfloat *v) { counters.uniformUploads++; real.ProgramUniform2fv(p, l, n, v); }
+    static void APIENTRY ProgramUniform3fv(GLuint p, GLint l, GLsizei n, const GLfloat *v) { counters.uniformUploads++; real.ProgramUniform3fv(p, l, n, v); }
+    static void APIENTRY ProgramUniform4fv(GLuint p, GLint l, GLsizei n, const GLfloat *v) { counters.uniformUploads++; real.ProgramUniform4fv(p, l, n, v); }
+    static void APIENTRY ProgramUniformMatrix2fv(GLuint p, GLint l, GLsizei n, GLboolean t, const GLfloat *v) { counters.uniformUploads++; real.ProgramUniformMatrix2fv(p, l, n, t, v); }
+    static void APIENTRY ProgramUniformMatrix3fv(GLuint p, GLint l, GLsizei n, GLboolean t, const GLfloat *v) { counters.uniformUploads++; real.ProgramUniformMatrix3fv(p, l, n, t, v); }
+    static void APIENTRY ProgramUniformMatrix4fv(GLuint p, GLint l, GLsizei n, GLboolean t, const GLfloat *v) { counters.uniformUploads++; real.ProgramUniformMatrix4fv(p, l, n, t, v); }
+
+    // uploads
+    static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+    {
+        if (data)
+            counters.bufferUploadBytes += size;
+        counters.bufferAllocations++;
+        counters.bufferAllocationBytes += size;
+        real.BufferData(target, size, data, usage);
+    }
+    static void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+    {
+        counters.bufferUploadBytes += size;
+        real.BufferSubData(target, offset, size, data);
+    }
+    static void APIENTRY TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+    {
+        if (pixels)
+            counters.textureUploadBytes += (uint64_t)width * height * pixelBytes(format, type);
+        counters.textureUploads++;
+        real.TexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+    }
+    static void APIENTRY TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+    {
+        counters.textureUploadBytes += (uint64_t)width * height * pixelBytes(format, type);
+        counters.textureUploads++;
+        real.TexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+    }
+    // shader builds
+    static void APIENTRY CompileShader(GLuint shader) { counters.shaderCompiles++; real.CompileShader(shader); }
+    static void APIENTRY LinkProgram(GLuint program) { counters.programLinks++; real.LinkProgram(program); }
+};
+#endif
@@ -0,0 +1,171 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// glad was generated for the 3.3 core profile only, so everything newer is loaded by hand here.
+// Each entry point stays null (and its flag false) when the driver doesn't expose it.
+// ------------------------------------------------------------------------
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_SEPARABLE
+#define GL_PROGRAM_SEPARABLE 0x8258
+#endif
+#ifndef GL_VERTEX_SHADER_BIT
+#define GL_VERTEX_SHADER_BIT 0x00000001
+#endif
+#ifndef GL_FRAGMENT_SHADER_BIT
+#define GL_FRAGMENT_SHADER_BIT 0x00000002
+#endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+typedef void (APIENTRYP PFNGETPROGRAMBINARY)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNPROGRAMBINARY)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNPROGRAMPARAMETERI)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSKHR)(GLuint count);
+typedef void (APIENTRYP PFNGENPROGRAMPIPELINES)(GLsizei n, GLuint *pipelines);
+typedef void (APIENTRYP PFNDELETEPROGRAMPIPELINES)(GLsizei n, const GLuint *pipelines);
+typedef void (APIENTRYP PFNBINDPROGRAMPIPELINE)(GLuint pipeline);
+typedef void (APIENTRYP PFNUSEPROGRAMSTAGES)(GLuint pipeline, GLbitfield stages, GLuint program);
+typedef void (APIENTRYP PFNPROGRAMUNIFORM1I)(GLuint program, GLint location, GLint v0);
+typedef void (APIENTRYP PFNPROGRAMUNIFORM1F)(GLuint program, GLint location, GLfloat v0);
+typedef void (APIENTRYP PFNPROGRAMUNIFORM2F)(GLuint program, GLint location, GLfloat v0, GLfloat v1);
+typedef void (APIENTRYP PFNPROGRAMUNIFORM3F)(GLuint program, GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+typedef void (APIENTRYP PFNPROGRAMUNIFORM4F)(GLuint program, GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+typedef void (APIENTRYP PFNPROGRAMUNIFORMFV)(GLuint program, GLint location, GLsizei count, const GLfloat *value);
+typedef void (APIENTRYP PFNBUFFERSTORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP PFNPROGRAMUNIFORMMATRIXFV)(GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+
+struct GLExtensions
+{
+    int major = 3;
+    int minor = 3;
+
+    // GL 4.1 / GL_ARB_get_program_binary, and the driver offers at least one binary format
+    bool programBinary = false;
+    PFNGETPROGRAMBINARY GetProgramBinary = nullptr;
+    PFNPROGRAMBINARY ProgramBinary = nullptr;
+    PFNPROGRAMPARAMETERI ProgramParameteri = nullptr;
+
+    // GL_KHR_parallel_shader_compile (or the ARB variant)
+    bool parallelShaderCompile = false;
+    PFNMAXSHADERCOMPILERTHREADSKHR MaxShaderCompilerThreads = nullptr;
+
+    // GL 4.1 / GL_ARB_separate_shader_objects program pipelines
+    bool separateShaderObjects = false;
+    PFNGENPROGRAMPIPELINES GenProgramPipelines = nullptr;
+    PFNDELETEPROGRAMPIPELINES DeleteProgramPipelines = nullptr;
+    PFNBINDPROGRAMPIPELINE BindProgramPipeline = nullptr;
+    PFNUSEPROGRAMSTAGES UseProgramStages = nullptr;
+    PFNPROGRAMUNIFORM1I ProgramUniform1i = nullptr;
+    PFNPROGRAMUNIFORM1F ProgramUniform1f = nullptr;
+    PFNPROGRAMUNIFORM2F ProgramUniform2f = nullptr;
+    PFNPROGRAMUNIFORM3F ProgramUniform3f = nullptr;
+    PFNPROGRAMUNIFORM4F ProgramUniform4f = nullptr;
+    PFNPROGRAMUNIFORMFV ProgramUniform2fv = nullptr;
+    PFNPROGRAMUNIFORMFV ProgramUniform3fv = nullptr;
+    PFNPROGRAMUNIFORMFV ProgramUniform4fv = nullptr;
+    PFNPROGRAMUNIFORMMATRIXFV ProgramUniformMatrix2fv = nullptr;
+    PFNPROGRAMUNIFORMMATRIXFV ProgramUniformMatrix3fv = nullptr;
+    PFNPROGRAMUNIFORMMATRIXFV ProgramUniformMatrix4fv = nullptr;
+
+    // GL 4.4 / GL_ARB_buffer_storage immutable buffers, which can stay mapped while the GPU uses them
+    bool bufferStorage = false;
+    PFNBUFFERSTORAGE BufferStorage = nullptr;
+
+    bool atLeast(int maj, int min) const
+    {
+        return major > maj || (major == maj && minor >= min);
+    }
+};
+
+inline GLExtensions glExt;
+
+inline bool hasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (ext && std::strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// call once right after gladLoadGLLoader, with the same loader
+inline void loadGLExtensions(GLADloadproc load)
+{
+    glGetIntegerv(GL_MAJOR_VERSION, &glExt.major);
+    glGetIntegerv(GL_MINOR_VERSION, &glExt.minor);
+
+    if (glExt.atLeast(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        glExt.GetProgramBinary = (PFNGETPROGRAMBINARY)load("glGetProgramBinary");
+        glExt.ProgramBinary = (PFNPROGRAMBINARY)load("glProgramBinary");
+        glExt.ProgramParameteri = (PFNPROGRAMPARAMETERI)load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        glExt.programBinary = glExt.GetProgramBinary && glExt.ProgramBinary && glExt.ProgramParameteri && formats > 0;
+    }
+
+    if (glExt.atLeast(4, 1) || hasGLExtension("GL_ARB_separate_shader_objects"))
+    {
+        glExt.ProgramParameteri = (PFNPROGRAMPARAMETERI)load("glProgramParameteri");
+        glExt.GenProgramPipelines = (PFNGENPROGRAMPIPELINES)load("glGenProgramPipelines");
+        glExt.DeleteProgramPipelines = (PFNDELETEPROGRAMPIPELINES)load("glDeleteProgramPipelines");
+        glExt.BindProgramPipeline = (PFNBINDPROGRAMPIPELINE)load("glBindProgramPipeline");
+        glExt.UseProgramStages = (PFNUSEPROGRAMSTAGES)load("glUseProgramStages");
+        glExt.ProgramUniform1i = (PFNPROGRAMUNIFORM1I)load("glProgramUniform1i");
+        glExt.ProgramUniform1f = (PFNPROGRAMUNIFORM1F)load("glProgramUniform1f");
+        glExt.ProgramUniform2f = (PFNPROGRAMUNIFORM2F)load("glProgramUniform2f");
+        glExt.ProgramUniform3f = (PFNPROGRAMUNIFORM3F)load("glProgramUniform3f");
+        glExt.ProgramUniform4f = (PFNPROGRAMUNIFORM4F)load("glProgramUniform4f");
+        glExt.ProgramUniform2fv = (PFNPROGRAMUNIFORMFV)load("glProgramUniform2fv");
+        glExt.ProgramUniform3fv = (PFNPROGRAMUNIFORMFV)load("glProgramUniform3fv");
+        glExt.ProgramUniform4fv = (PFNPROGRAMUNIFORMFV)load("glProgramUniform4fv");
+        glExt.ProgramUniformMatrix2fv = (PFNPROGRAMUNIFORMMATRIXFV)load("glProgramUniformMatrix2fv");
+        glExt.ProgramUniformMatrix3fv = (PFNPROGRAMUNIFORMMATRIXFV)load("glProgramUniformMatrix3fv");
+        glExt.ProgramUniformMatrix4fv = (PFNPROGRAMUNIFORMMATRIXFV)load("glProgramUniformMatrix4fv");
+        glExt.separateShaderObjects = glExt.ProgramParameteri && glExt.GenProgramPipelines && glExt.DeleteProgramPipelines && glExt.BindProgramPipeline
+            && glExt.UseProgramStages && glExt.ProgramUniform1i && glExt.ProgramUniformMatrix4fv;
+    }
+
+    if (glExt.atLeast(4, 4) || hasGLExtension("GL_ARB_buffer_storage"))
+        glExt.BufferStorage = (PFNBUFFERSTORAGE)load("glBufferStorage");
+    glExt.bufferStorage = glExt.BufferStorage != nullptr;
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        glExt.MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSKHR)load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        glExt.MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSKHR)load("glMaxShaderCompilerThreadsARB");
+    glExt.parallelShaderCompile = glExt.MaxShaderCompilerThreads != nullptr;
+}
+#endif
@@ -0,0 +1,69 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <iostream>
+
+// An OpenGL 3.3 core context without a visible window, for running the renderer on build
+// machines. Rendering is expected to go to a framebuffer object. create() asks GLFW for the
+// context through OSMesa first (Mesa's software rasterizer, no GPU or driver needed), then EGL
+// (llvmpipe or a GPU without a GLX or CGL drawable), then the platform's own API, and logs the one
+// it got. All three belong to a hidden GLFW window: GLFW 3.3 still connects to the window system
+// in glfwInit(), so a machine without a display needs a virtual one such as Xvfb, but the first
+// two render without a window server.
+class HeadlessContext
+{
+public:
+    bool create(int width, int height)
+    {
+        struct Api
+        {
+            int api;
+            const char* name;
+        };
+        const Api apis[] = {
+            { GLFW_OSMESA_CONTEXT_API, "OSMesa" },
+            { GLFW_EGL_CONTEXT_API, "EGL" },
+            { GLFW_NATIVE_CONTEXT_API, "hidden window" },
+        };
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        for (const Api &api : apis)
+        {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, api.api);
+            window = glfwCreateWindow(width, height, "LearnOpenGL (offscreen)", NULL, NULL);
+            if (window)
+            {
+                std::cout << "headless: " << api.name << " context" << std::endl;
+                break;
+            }
+        }
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (window == NULL)
+            return false;
+        glfwMakeContextCurrent(window);
+        return true;
+    }
+
+    // glfwGetProcAddress resolves through whichever API the context came from
+    GLADloadproc loader() const
+    {
+        return (GLADloadproc)glfwGetProcAddress;
+    }
+
+    void destroy()
+    {
+        if (window)
+        {
+            glfwDestroyWindow(window);
+            window = NULL;
+        }
+    }
+
+private:
+    GLFWwindow* window = NULL;
+};
+#endif
@@ -0,0 +1,186 @@
+#ifndef HITCH_DETECTOR_H
+#define HITCH_DETECTOR_H
+
+#include "GLCounters.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Flags frames that take much longer than the recent ones (--hitches [hitches.log]) and writes
+// down what ran in them. A frame is a hitch when it is more than `factor` times the median of the
+// last HISTORY frames, and at least minExcessMs over it so sub-millisecond noise on fast frames
+// doesn't count.
+//
+// Causes come from two places: HITCH_SCOPE blocks around one-off work (asset loads, shader builds,
+// texture loads), recorded with their duration and asset, and GLCounters' per-frame counts of
+// shader compiles, program links, texture uploads and buffer allocations. The frame time measured
+// is the CPU side of the frame, up to the swap, which is where those stalls land.
+class HitchDetector
+{
+public:
+    inline static double factor = 2.0;
+    inline static double minExcessMs = 2.0;
+
+    // starts detecting and logging, GLCounters has to be installed for the GL causes
+    static bool enable(const std::string &path)
+    {
+        log.open(path);
+        if (!log)
+        {
+            std::cout << "ERROR::HITCH_DETECTOR::CANNOT_WRITE_LOG: " << path << std::endl;
+            return false;
+        }
+        log << std::fixed << std::setprecision(2);
+        enabled = true;
+        return true;
+    }
+
+    static bool isEnabled()
+    {
+        return enabled;
+    }
+
+    // something that ran in the current frame. Thread safe.
+    static void note(const char* subsystem, const std::string &detail, double ms)
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        causes.push_back({ subsystem, detail, ms });
+    }
+
+    // drops causes noted between frames (startup loading belongs to no frame)
+    static void beginFrame()
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        causes.clear();
+    }
+
+    // call after GLCounters::endFrame(), with the frame's CPU time
+    static void endFrame(double frameMs)
+    {
+        if (!enabled)
+            return;
+        frameNumber++;
+        if (filled >= MIN_HISTORY)
+        {
+            std::array<double, HISTORY> sorted;
+            std::copy(history.begin(), history.begin() + filled, sorted.begin());
+            std::nth_element(sorted.begin(), sorted.begin() + filled / 2, sorted.begin() + filled);
+            double median = sorted[filled / 2];
+            if (frameMs > median * factor && frameMs > median + minExcessMs)
+                report(frameMs, median);
+        }
+        history[historyNext] = frameMs;
+        historyNext = (historyNext + 1) % HISTORY;
+        filled = std::min(filled + 1, HISTORY);
+    }
+
+    static uint64_t hitchCount()
+    {
+        return hitches;
+    }
+
+    static void close()
+    {
+        if (!enabled)
+            return;
+        log.close();
+        enabled = false;
+        std::cout << "hitches: " << hitches << " of " << frameNumber << " frames over " << factor << "x the median" << std::endl;
+    }
+
+private:
+    struct Cause
+    {
+        const char* subsystem;
+        std::string detail;
+        double ms;
+    };
+
+    static constexpr int HISTORY = 120;
+    // frames needed before the median means anything
+    static constexpr int MIN_HISTORY = 30;
+
+    inline static bool enabled = false;
+    inline static std::ofstream log;
+    inline static std::mutex mutex;
+    inline static std::vector<Cause> causes;
+    inline static std::array<double, HISTORY> history{};
+    inline static int historyNext = 0;
+    inline static int filled = 0;
+    inline static uint64_t frameNumber = 0;
+    inline static uint64_t hitches = 0;
+
+    static void report(double frameMs, double median)
+    {
+        hitches++;
+        log << "frame " << frameNumber << ": " << frameMs << " ms, " << frameMs / median << "x the median of " << median << " ms\n";
+        bool explained = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Cause &cause : causes)
+                log << "  " << cause.subsystem << ": " << cause.detail << " (" << cause.ms << " ms)\n";
+            explained = !causes.empty();
+        }
+        if (GLCounters::isInstalled())
+        {
+            const GLFrameCounters &c = GLCounters::lastFrame();
+            const double MB = 1024.0 * 1024.0;
+            if (c.shaderCompiles || c.programLinks)
+                log << "  gl: " << c.shaderCompiles << " shader compiles, " << c.programLinks << " program links\n";
+            if (c.textureUploads)
+                log << "  gl: " << c.textureUploads << " texture uploads, " << c.textureUploadBytes / MB << " MB\n";
+            if (c.bufferAllocations)
+                log << "  gl: " << c.bufferAllocations << " buffer allocations, " << c.bufferAllocationBytes / MB << " MB\n";
+            explained = explained || c.shaderCompiles || c.programLinks || c.textureUploads || c.bufferAllocations;
+        }
+        if (!explained)
+            log << "  no recorded cause (driver, GPU or OS)\n";
+        log.flush();
+    }
+};
+
+// records the enclosing block as a hitch cause when it ends
+class HitchScope
+{
+public:
+    HitchScope(const char* subsystem, const char* detail)
+    {
+        if (!HitchDetector::isEnabled())
+            return;
+        this->subsystem = subsystem;
+        this->detail = detail;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~HitchScope()
+    {
+        if (subsystem)
+            HitchDetector::note(subsystem, detail, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    HitchScope(const HitchScope&) = delete;
+    HitchScope& operator=(const HitchScope&) = delete;
+
+private:
+    const char* subsystem = nullptr;
+    std::string detail;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define HITCH_CONCAT_INNER(a, b) a##b
+#define HITCH_CONCAT(a, b) HITCH_CONCAT_INNER(a, b)
+// hitch cause `subsystem` (e.g. "asset load") with detail (e.g. the path) for the rest of the block
+#define HITCH_SCOPE(subsystem, detail) HitchScope HITCH_CONCAT(hitchScope, __LINE__)(subsystem, detail)
+#endif
@@ -0,0 +1,326 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <glad/glad.h>
+
+#include "GLCounters.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// On-screen stats overlay, toggled with H: a rolling frame-time graph with the CPU part of each
+// frame, CPU/GPU time, draw calls, triangles, tracked memory and the GPU time of every pass.
+//
+// Text uses a built-in 5x7 pixel font baked into a small GL_R8 atlas at init(); rectangles and
+// graph bars sample the atlas' solid cell. All of it is written into one streamed vertex buffer
+// and drawn with a single glDrawArrays per frame. Draw calls and triangles come from GLCounters,
+// memory from MemoryTracker and pass times from the profiler's GPU queries. The counters are
+// installed the first time the HUD is shown, and the profiler is on while it's shown; pass times
+// are read from the profiler's per-name latest spans, so the cost doesn't grow with the session.
+class Hud
+{
+public:
+    // GPU profiler scopes listed under the totals, in this order
+    std::vector<const char*> passes;
+    // extra line under the memory totals, e.g. a debug view's numbers. Empty hides it.
+    std::string status;
+
+    // call with the context current
+    void init()
+    {
+        MEMORY_TAG("hud", "");
+        std::vector<unsigned char> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+        for (int glyph = 0; glyph < GLYPH_COUNT; glyph++)
+        {
+            int cellX = (glyph % ATLAS_COLUMNS) * CELL_WIDTH;
+            int cellY = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+            for (int column = 0; column < 5; column++)
+                for (int row = 0; row < 7; row++)
+                    if (font[glyph][column] & (1 << row))
+                        pixels[(cellY + row) * ATLAS_WIDTH + cellX + column] = 255;
+        }
+        // solid cell for rectangles, right after the glyphs
+        int solidX = (GLYPH_COUNT % ATLAS_COLUMNS) * CELL_WIDTH;
+        int solidY = (GLYPH_COUNT / ATLAS_COLUMNS) * CELL_HEIGHT;
+        for (int y = 0; y < CELL_HEIGHT; y++)
+            std::fill_n(&pixels[(solidY + y) * ATLAS_WIDTH + solidX], CELL_WIDTH, 255);
+        solidU = (solidX + CELL_WIDTH * 0.5f) / ATLAS_WIDTH;
+        solidV = (solidY + CELL_HEIGHT * 0.5f) / ATLAS_HEIGHT;
+
+        glGenTextures(1, &atlas);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        capacity = 4096;
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(HudVertex), NULL, GL_STREAM_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, x));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, u));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)offsetof(HudVertex, color));
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+
+        shader.reset(new Shader("hud_v", "hud_f"));
+        shader->use();
+        shader->setInt("atlas", 0);
+        vertices.reserve(capacity);
+    }
+
+    bool isVisible() const
+    {
+        return visible;
+    }
+
+    void toggle()
+    {
+        visible = !visible;
+        // runs that never show the HUD keep GL calls direct, draw counts start with the first frame shown
+        if (visible && !GLCounters::isInstalled())
+            GLCounters::install();
+        // per-pass times need the GPU queries, leave the profiler as we found it when hiding
+        if (visible && !Profiler::get().isEnabled())
+        {
+            Profiler::get().setEnabled(true);
+            enabledProfiler = true;
+        }
+        else if (!visible && enabledProfiler)
+        {
+            Profiler::get().setEnabled(false);
+            enabledProfiler = false;
+        }
+    }
+
+    // adds one frame to the graph, also while hidden so the graph is full when it's shown
+    void addFrame(float frameMs, float cpuMs)
+    {
+        frameHistory[historyNext] = frameMs;
+        cpuHistory[historyNext] = cpuMs;
+        historyNext = (historyNext + 1) % HISTORY;
+    }
+
+    // draws the overlay into the bound framebuffer of width x height pixels. Leaves depth testing
+    // enabled and blending disabled, the state the scene is drawn with.
+    void draw(int width, int height)
+    {
+        if (!visible || !shader || width <= 0 || height <= 0)
+            return;
+        auto start = std::chrono::steady_clock::now();
+        vertices.clear();
+        scale = std::max(1, (height + 200) / 400);
+
+        int latest = (historyNext + HISTORY - 1) % HISTORY;
+        float frameMs = frameHistory[latest];
+        float cpuMs = cpuHistory[latest];
+        double gpuMs = 0.0;
+        std::array<double, 8> passMs{};
+        size_t passCount = std::min(passes.size(), passMs.size());
+        for (size_t i = 0; i < passCount; i++)
+        {
+            // a pass that stopped running (the pre-pass switched off) drops out after a moment
+            passMs[i] = Profiler::get().lastGpuMs(passes[i], 250.0);
+            gpuMs += passMs[i];
+        }
+        const GLFrameCounters &counters = GLCounters::lastFrame();
+        MemoryTotals memory = MemoryTracker::totals();
+
+        const int lineHeight = (CELL_HEIGHT + 2) * scale;
+        const int graphWidth = HISTORY * scale;
+        const int graphHeight = 50 * scale;
+        const int lines = 6 + (int)passCount + (status.empty() ? 0 : 1);
+        const int pad = 4 * scale;
+        const int panelWidth = std::max(graphWidth, 28 * CELL_WIDTH * scale) + 2 * pad;
+        const int panelHeight = lines * lineHeight + graphHeight + 3 * pad;
+        rect(0, 0, (float)panelWidth, (float)panelHeight, 0xB0000000);
+
+        const uint32_t white = 0xFFFFFFFF, grey = 0xFFB0B0B0;
+        char line[64];
+        float x = (float)pad, y = (float)pad;
+        std::snprintf(line, sizeof(line), "FRAME %6.2f MS %5.0f FPS", frameMs, frameMs > 0.0f ? 1000.0f / frameMs : 0.0f);
+        text(x, y, line, white);
+        y += lineHeight;
+        std::snprintf(line, sizeof(line), "CPU %6.2f  GPU %6.2f MS", cpuMs, gpuMs);
+        text(x, y, line, white);
+        y += lineHeight;
+        std::snprintf(line, sizeof(line), "DRAWS %llu  TRIS %.1fK", (unsigned long long)counters.drawCalls, counters.triangles / 1000.0);
+        text(x, y, line, white);
+        y += lineHeight;
+        const double MB = 1024.0 * 1024.0;
+        std::snprintf(line, sizeof(line), "GPU MEM %.1f MB TEX %.1f", memory.gpuBytes() / MB, memory.textureBytes / MB);
+        text(x, y, line, white);
+        y += lineHeight;
+        std::snprintf(line, sizeof(line), "CPU MEM %.1f MB (M: REPORT)", memory.cpuBytes / MB);
+        text(x, y, line, white);
+        y += lineHeight;
+        if (!status.empty())
+        {
+            text(x, y, status.c_str(), white);
+            y += lineHeight;
+        }
+        for (size_t i = 0; i < passCount; i++)
+        {
+            std::snprintf(line, sizeof(line), " %-14.14s %6.2f MS", passes[i], passMs[i]);
+            text(x, y, line, grey);
+            y += lineHeight;
+        }
+        std::snprintf(line, sizeof(line), "HUD %.3f MS", lastCostMs);
+        text(x, y, line, grey);
+        y += lineHeight + pad;
+
+        // frame-time graph, oldest frame on the left, 33.3 ms at the top. Each bar is the whole
+        // frame, its CPU part drawn over the bottom in blue.
+        const float graphTop = y;
+        const float graphBottom = y + graphHeight;
+        const float topMs = 100.0f / 3.0f;
+        rect(x, graphTop, (float)graphWidth, (float)graphHeight, 0x60000000);
+        for (int i = 0; i < HISTORY; i++)
+        {
+            int sample = (historyNext + i) % HISTORY;
+            float frame = frameHistory[sample];
+            float barHeight = std::min(frame / topMs, 1.0f) * graphHeight;
+            float cpuHeight = std::min(cpuHistory[sample] / topMs, 1.0f) * graphHeight;
+            uint32_t color = frame <= 1000.0f / 60.0f + 0.5f ? 0xFF40C040 : (frame <= topMs + 0.5f ? 0xFF30C0E0 : 0xFF4040E0);
+            float barX = x + i * scale;
+            rect(barX, graphBottom - barHeight, (float)scale, barHeight, color);
+            rect(barX, graphBottom - std::min(cpuHeight, barHeight), (float)scale, std::min(cpuHeight, barHeight), 0xFFE08040);
+        }
+        // 60 fps line
+        rect(x, graphBottom - graphHeight * (1000.0f / 60.0f) / topMs, (float)graphWidth, 1.0f, 0x80FFFFFF);
+
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        shader->use();
+        shader->setVec2("screenSize", (float)width, (float)height);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // orphan the old contents so the upload never waits on last frame's draw
+        if (vertices.size() > capacity)
+            capacity = vertices.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(HudVertex), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(HudVertex), vertices.data());
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+        glBindVertexArray(0);
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+
+        lastCostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // call while the context is still current
+    void release()
+    {
+        if (VAO)
+            glDeleteVertexArrays(1, &VAO);
+        if (VBO)
+            glDeleteBuffers(1, &VBO);
+        if (atlas)
+            glDeleteTextures(1, &atlas);
+        VAO = VBO = atlas = 0;
+        if (shader)
+            shader->release();
+        shader.reset();
+    }
+
+private:
+    struct HudVertex
+    {
+        float x, y;         // pixels, origin top left
+        float u, v;
+        uint32_t color;     // 0xAABBGGRR, i.e. RGBA bytes in memory on little-endian machines
+    };
+
+    static constexpr int HISTORY = 120;
+    // glyphs for ' ' (0x20) to '_' (0x5F), lower case is drawn as upper case
+    static constexpr int GLYPH_COUNT = 64;
+    static constexpr int CELL_WIDTH = 6;
+    static constexpr int CELL_HEIGHT = 8;
+    static constexpr int ATLAS_COLUMNS = 16;
+    static constexpr int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+    static constexpr int ATLAS_HEIGHT = (GLYPH_COUNT / ATLAS_COLUMNS + 1) * CELL_HEIGHT;
+
+    // 5x7 font, one byte per column, bit 0 the top row
+    static constexpr unsigned char font[GLYPH_COUNT][5] = {
+        {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14}, // space ! " #
+        {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, // $ % & '
+        {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08}, // ( ) * +
+        {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02}, // , - . /
+        {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, // 0 1 2 3
+        {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, // 4 5 6 7
+        {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00}, // 8 9 : ;
+        {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, // < = > ?
+        {0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, // @ A B C
+        {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A}, // D E F G
+        {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, // H I J K
+        {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, // L M N O
+        {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31}, // P Q R S
+        {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, // T U V W
+        {0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00}, // X Y Z [
+        {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40}, // \ ] ^ _
+    };
+
+    bool visible = false;
+    bool enabledProfiler = false;
+    int scale = 1;
+    float solidU = 0.0f, solidV = 0.0f;
+    GLuint atlas = 0;
+    GLuint VAO = 0, VBO = 0;
+    size_t capacity = 0;
+    std::unique_ptr<Shader> shader;
+    std::vector<HudVertex> vertices;
+    std::array<float, HISTORY> frameHistory{};
+    std::array<float, HISTORY> cpuHistory{};
+    int historyNext = 0;
+    double lastCostMs = 0.0;
+
+    void quad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t color)
+    {
+        HudVertex a = { x, y, u0, v0, color };
+        HudVertex b = { x + w, y, u1, v0, color };
+        HudVertex c = { x + w, y + h, u1, v1, color };
+        HudVertex d = { x, y + h, u0, v1, color };
+        vertices.insert(vertices.end(), { a, b, c, a, c, d });
+    }
+
+    // color as 0xAABBGGRR
+    void rect(float x, float y, float w, float h, uint32_t color)
+    {
+        quad(x, y, w, h, solidU, solidV, solidU, solidV, color);
+    }
+
+    void text(float x, float y, const char* string, uint32_t color)
+    {
+        for (const char* c = string; *c; c++, x += CELL_WIDTH * scale)
+        {
+            int code = (*c >= 'a' && *c <= 'z') ? *c - 'a' + 'A' : *c;
+            if (code == ' ')
+                continue;
+            int glyph = (code >= 0x20 && code < 0x20 + GLYPH_COUNT) ? code - 0x20 : '?' - 0x20;
+            float u = (float)((glyph % ATLAS_COLUMNS) * CELL_WIDTH) / ATLAS_WIDTH;
+            float v = (float)((glyph / ATLAS_COLUMNS) * CELL_HEIGHT) / ATLAS_HEIGHT;
+            quad(x, y, (float)(CELL_WIDTH * scale), (float)(CELL_HEIGHT * scale), u, v,
+                 u + (float)CELL_WIDTH / ATLAS_WIDTH, v + (float)CELL_HEIGHT / ATLAS_HEIGHT, color);
+        }
+    }
+};
+#endif
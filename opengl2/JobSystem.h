@@ -0,0 +1,450 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct Job;
+
+// number of jobs still to finish. Jobs given the counter increment it when submitted and
+// decrement it when done; JobSystem::wait() helps run jobs until it reaches zero. Jobs submitted
+// to run after the counter are parked on it and queued by the thread that finishes its last job.
+struct JobCounter
+{
+    std::atomic<int> pending{0};
+    // taken for the decrement to zero, so a job is either parked before it or sees the counter done
+    mutable std::mutex continuationMutex;
+    std::vector<Job*> continuations;
+
+    bool done() const
+    {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+};
+
+struct Job
+{
+    std::function<void()> task;
+    JobCounter* counter = nullptr;
+    // pool slot still queued or running
+    std::atomic<bool> inUse{false};
+    // allocated because the pool slot was busy or the submitting thread has no pool
+    bool heap = false;
+};
+
+// Chase-Lev work-stealing deque of fixed capacity (the C11 formulation of Lê, Pop, Cohen and
+// Zappa Nardelli). Only the owning thread pushes and pops, at the bottom; any thread steals from
+// the top.
+class WorkStealingDeque
+{
+public:
+    static constexpr int64_t CAPACITY = 4096;
+
+    // owner only. False when full, the caller runs the job some other way.
+    bool push(Job* job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+            return false;
+        buffer[b & MASK].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // owner only, newest job first
+    Job* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = buffer[b & MASK].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // last job, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // any thread, oldest job first. Null when empty or another thread won the job.
+    Job* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        Job* job = buffer[t & MASK].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+
+private:
+    static constexpr int64_t MASK = CAPACITY - 1;
+    // top and bottom on their own cache lines, thieves hammer one and the owner the other
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Job*> buffer[CAPACITY] = {};
+};
+
+// Fixed pool of worker threads, one per core counting the thread that calls init(), each with
+// its own work-stealing deque. A thread pushes the jobs it submits onto its own deque and pops
+// them newest first; idle threads steal the oldest jobs of others, so a big batch spreads out
+// without a shared queue. Threads outside the pool submit through a locked queue.
+//
+// Waiting on a counter runs other jobs meanwhile, so jobs may wait on jobs they submitted. A job
+// can also be submitted to run after a counter, which holds no thread until it's done: stages of
+// work chain up front and the caller only waits on the last one.
+// Workers with nothing to do spin briefly and then sleep until new work is submitted.
+//
+// Before init() (and after shutdown()) everything runs inline on the caller, so code written
+// against the job system works unchanged in single threaded tools like the microbenchmarks.
+class JobSystem
+{
+public:
+    static JobSystem& get()
+    {
+        static JobSystem instance;
+        return instance;
+    }
+
+    // threads: total including the caller, 0 for one per core. pin ties each thread to a core
+    // (Linux), or gives each its own affinity tag (macOS, a hint the scheduler may ignore).
+    void init(unsigned threads = 0, bool pin = false)
+    {
+        shutdown();
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        count = threads;
+        pinned = pin;
+        deques.reset(new WorkStealingDeque[count]);
+        pools.reset(new std::unique_ptr<Job[]>[count]);
+        poolNext.assign(count, 0);
+        for (unsigned i = 0; i < count; i++)
+            pools[i].reset(new Job[POOL_SIZE]);
+        threadIndex = 0;
+        if (pinned)
+            pinToCore(0);
+        running.store(true);
+        for (unsigned i = 1; i < count; i++)
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    // joins the workers. Jobs still queued are dropped, wait on their counters first.
+    void shutdown()
+    {
+        if (!running.load())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running.store(false);
+        }
+        sleepCondition.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+        workers.clear();
+        deques.reset();
+        pools.reset();
+        injected.clear();
+        threadIndex = -1;
+        count = 0;
+    }
+
+    bool isRunning() const
+    {
+        return running.load(std::memory_order_relaxed);
+    }
+
+    // threads running jobs, the caller of init() included. 1 when not running.
+    unsigned threadCount() const
+    {
+        return std::max(count, 1u);
+    }
+
+    // index of the calling thread in the pool, -1 outside it
+    static int currentThread()
+    {
+        return threadIndex;
+    }
+
+    // queues task, counting it on counter (if any). With after, the task waits parked on that
+    // counter and is queued once its last job is done; no thread blocks on it meanwhile.
+    void run(std::function<void()> task, JobCounter* counter = nullptr, JobCounter* after = nullptr)
+    {
+        if (!isRunning())
+        {
+            // inline, anything it could depend on already ran
+            task();
+            return;
+        }
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        Job* job = allocate();
+        job->task = std::move(task);
+        job->counter = counter;
+        if (after)
+        {
+            std::lock_guard<std::mutex> lock(after->continuationMutex);
+            if (!after->done())
+            {
+                after->continuations.push_back(job);
+                return;
+            }
+        }
+        enqueue(job);
+    }
+
+    // returns once counter is done, running queued jobs in the meantime
+    void wait(const JobCounter &counter)
+    {
+        while (!counter.done())
+        {
+            if (Job* job = findJob())
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+        // the thread that finished the last job may still be queuing its continuations, it's
+        // through once the lock is free, and only then may the caller destroy the counter
+        std::lock_guard<std::mutex> lock(counter.continuationMutex);
+    }
+
+    // calls body(begin, end) over [0, count) in chunks of grain items spread over the pool and
+    // returns when all are done. grain 0 picks about four chunks per thread, enough for stealing
+    // to even out uneven chunks without drowning small loops in job overhead; pass a grain for
+    // loops whose items are very cheap or very uneven.
+    template <typename Body>
+    void parallelFor(size_t itemCount, Body &&body, size_t grain = 0)
+    {
+        if (itemCount == 0)
+            return;
+        if (grain == 0)
+            grain = std::max<size_t>(1, itemCount / (threadCount() * 4));
+        if (!isRunning() || itemCount <= grain)
+        {
+            body((size_t)0, itemCount);
+            return;
+        }
+        JobCounter counter;
+        for (size_t begin = grain; begin < itemCount; begin += grain)
+        {
+            size_t end = std::min(begin + grain, itemCount);
+            run([&body, begin, end] { body(begin, end); }, &counter);
+        }
+        // the caller takes the first chunk itself
+        body((size_t)0, grain);
+        wait(counter);
+    }
+
+    ~JobSystem()
+    {
+        shutdown();
+    }
+
+private:
+    // jobs each pool thread can have queued or running before falling back to the heap
+    static constexpr size_t POOL_SIZE = 4096;
+    // rounds a worker keeps looking for work before it goes to sleep
+    static constexpr int SPIN_ROUNDS = 64;
+
+    inline static thread_local int threadIndex = -1;
+
+    unsigned count = 0;
+    bool pinned = false;
+    std::atomic<bool> running{false};
+    std::vector<std::thread> workers;
+    std::unique_ptr<WorkStealingDeque[]> deques;
+    std::unique_ptr<std::unique_ptr<Job[]>[]> pools;
+    std::vector<size_t> poolNext;
+
+    std::mutex injectMutex;
+    std::deque<Job*> injected;
+    std::atomic<size_t> injectedCount{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<uint64_t> workVersion{0};
+    std::atomic<int> sleepers{0};
+
+    Job* allocate()
+    {
+        if (threadIndex >= 0)
+        {
+            Job &slot = pools[threadIndex][poolNext[threadIndex]++ % POOL_SIZE];
+            if (!slot.inUse.load(std::memory_order_acquire))
+            {
+                slot.inUse.store(true, std::memory_order_relaxed);
+                slot.heap = false;
+                return &slot;
+            }
+        }
+        Job* job = new Job();
+        job->heap = true;
+        return job;
+    }
+
+    void enqueue(Job* job)
+    {
+        if (threadIndex < 0 || !deques[threadIndex].push(job))
+        {
+            std::lock_guard<std::mutex> lock(injectMutex);
+            injected.push_back(job);
+            injectedCount.fetch_add(1, std::memory_order_release);
+        }
+        wake();
+    }
+
+    void execute(Job* job)
+    {
+        job->task();
+        // drop the captures before the slot can be reused
+        job->task = nullptr;
+        JobCounter* counter = job->counter;
+        if (job->heap)
+            delete job;
+        else
+            job->inUse.store(false, std::memory_order_release);
+        if (counter)
+            finish(*counter);
+    }
+
+    // one job of counter done. Decrements that leave jobs pending stay lock free; the last one
+    // takes the lock and queues the jobs parked on the counter.
+    void finish(JobCounter &counter)
+    {
+        int pending = counter.pending.load(std::memory_order_relaxed);
+        while (pending > 1)
+            if (counter.pending.compare_exchange_weak(pending, pending - 1, std::memory_order_release, std::memory_order_relaxed))
+                return;
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter.continuationMutex);
+            // a job counted on it meanwhile keeps the counter pending
+            if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                ready.swap(counter.continuations);
+        }
+        // the counter may be gone by now
+        for (Job* job : ready)
+            enqueue(job);
+    }
+
+    Job* findJob()
+    {
+        if (threadIndex >= 0)
+            if (Job* job = deques[threadIndex].pop())
+                return job;
+        if (injectedCount.load(std::memory_order_acquire) > 0)
+        {
+            std::lock_guard<std::mutex> lock(injectMutex);
+            if (!injected.empty())
+            {
+                Job* job = injected.front();
+                injected.pop_front();
+                injectedCount.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        // steal, starting at a random victim so thieves don't all line up on the same one
+        static thread_local uint32_t seed = 0x9E3779B9u ^ (uint32_t)(threadIndex + 1) * 0x85EBCA6Bu;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        for (unsigned i = 0; i < count; i++)
+        {
+            unsigned victim = (seed + i) % count;
+            if ((int)victim == threadIndex)
+                continue;
+            if (Job* job = deques[victim].steal())
+                return job;
+        }
+        return nullptr;
+    }
+
+    void wake()
+    {
+        workVersion.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) > 0)
+        {
+            // taking the lock orders this with a worker between checking workVersion and sleeping
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            sleepCondition.notify_one();
+        }
+    }
+
+    void workerLoop(unsigned index)
+    {
+        threadIndex = (int)index;
+        if (pinned)
+            pinToCore(index);
+        while (running.load(std::memory_order_relaxed))
+        {
+            uint64_t version = workVersion.load(std::memory_order_seq_cst);
+            Job* job = nullptr;
+            for (int round = 0; round < SPIN_ROUNDS && !job; round++)
+            {
+                job = findJob();
+                if (!job)
+                    std::this_thread::yield();
+            }
+            if (job)
+            {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            sleepCondition.wait(lock, [&] { return workVersion.load(std::memory_order_seq_cst) != version || !running.load(); });
+            sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        }
+        threadIndex = -1;
+    }
+
+    static void pinToCore(unsigned index)
+    {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cores, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(__APPLE__)
+        // threads with different tags are kept apart when possible; Apple silicon ignores it
+        thread_affinity_policy_data_t policy = { (integer_t)(index % cores + 1) };
+        thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY, (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
+#else
+        (void)index;
+        (void)cores;
+#endif
+    }
+};
+#endif
@@ -0,0 +1,226 @@
+#ifndef LOAD_REPORT_H
+#define LOAD_REPORT_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum LoadPhase {
+    LOAD_CONTEXT,           // window and GL context creation
+    LOAD_GLAD,              // GL function pointers and extensions
+    LOAD_SHADER_COMPILE,    // source reads, compile and link, or a program binary restore
+    LOAD_ASSIMP_IMPORT,     // Assimp's ReadFile with its post-processing
+    LOAD_PROCESS_MESH,      // converting aiMesh data into our vertices and indices
+    LOAD_IMAGE_DECODE,      // stbi_load
+    LOAD_GPU_UPLOAD,        // glBufferData and glTexImage2D
+    LOAD_MIPMAPS,           // glGenerateMipmap
+    LOAD_PHASE_COUNT
+};
+
+// Where startup time goes (--load-report): time per phase, and per asset with the bytes read from
+// disk and uploaded to GL, printed as a table once the first frame is about to start.
+//
+// Phases are timed by LOAD_PHASE blocks. Time is exclusive, a block nested in another (a texture
+// load inside processMesh, setupMesh's upload inside the Mesh constructor) is taken out of the
+// outer one. On the thread that enabled the report the phases plus "other", what no block covers,
+// add up to the startup time. Blocks on job system workers (UploadQueue's image decodes) overlap
+// that time, so they are listed apart as worker CPU time and never counted against it.
+// Nothing is recorded unless enabled.
+class LoadReport
+{
+public:
+    // call on the thread that loads the scene
+    static void enable()
+    {
+        loadingThread = std::this_thread::get_id();
+        enabled = true;
+    }
+
+    static bool isEnabled()
+    {
+        return enabled;
+    }
+
+    // time spent in phase for asset, by the calling thread. Thread safe.
+    static void add(LoadPhase phase, const std::string &asset, double ms)
+    {
+        if (!enabled)
+            return;
+        bool worker = std::this_thread::get_id() != loadingThread;
+        std::lock_guard<std::mutex> lock(mutex);
+        (worker ? workerMs : phaseMs)[phase] += ms;
+        assets[asset].phaseMs[phase] += ms;
+    }
+
+    static void addBytesRead(const std::string &asset, uint64_t bytes)
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        assets[asset].bytesRead += bytes;
+    }
+
+    static void addBytesUploaded(const std::string &asset, uint64_t bytes)
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        assets[asset].bytesUploaded += bytes;
+    }
+
+    // size of a file about to be read, 0 if it can't be opened
+    static uint64_t fileSize(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        return file ? (uint64_t)file.tellg() : 0;
+    }
+
+    static double msSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // prints the tables and stops recording, totalMs is the whole startup
+    static void finish(std::ostream &out, double totalMs)
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        enabled = false;
+        const double MB = 1024.0 * 1024.0;
+        out << std::fixed << std::setprecision(2);
+        out << "startup: " << totalMs << " ms, loading thread wall time; worker CPU time overlaps it\n";
+        double covered = 0.0;
+        for (int phase = 0; phase < LOAD_PHASE_COUNT; phase++)
+        {
+            out << "  " << std::left << std::setw(16) << phaseNames[phase] << std::right << std::setw(10) << phaseMs[phase]
+                << " ms " << std::setw(5) << std::setprecision(1) << percent(phaseMs[phase], totalMs) << "%" << std::setprecision(2);
+            if (workerMs[phase] > 0.0)
+                out << "  + " << workerMs[phase] << " ms worker CPU";
+            out << "\n";
+            covered += phaseMs[phase];
+        }
+        // only clock granularity can push the phases past the total now
+        double other = std::max(totalMs - covered, 0.0);
+        out << "  " << std::left << std::setw(16) << "other" << std::right << std::setw(10) << other
+            << " ms " << std::setw(5) << std::setprecision(1) << percent(other, totalMs) << "%\n" << std::setprecision(2);
+
+        // slowest assets first; an asset's time is its loading thread and worker time together
+        std::vector<std::pair<double, const std::string*>> order;
+        for (const auto &entry : assets)
+        {
+            double ms = 0.0;
+            for (double phase : entry.second.phaseMs)
+                ms += phase;
+            order.push_back({ ms, &entry.first });
+        }
+        std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+        out << "\n  " << std::left << std::setw(32) << "asset" << std::right << std::setw(10) << "total ms";
+        for (int phase = LOAD_SHADER_COMPILE; phase < LOAD_PHASE_COUNT; phase++)
+            out << std::setw(15) << phaseNames[phase];
+        out << std::setw(10) << "read MB" << std::setw(12) << "upload MB" << "\n";
+        for (const auto &row : order)
+        {
+            const Asset &asset = assets[*row.second];
+            std::string name = row.second->empty() ? "(none)" : *row.second;
+            if (name.size() > 31)
+                name = "..." + name.substr(name.size() - 28);
+            out << "  " << std::left << std::setw(32) << name << std::right << std::setw(10) << row.first;
+            for (int phase = LOAD_SHADER_COMPILE; phase < LOAD_PHASE_COUNT; phase++)
+                out << std::setw(15) << asset.phaseMs[phase];
+            out << std::setw(10) << asset.bytesRead / MB << std::setw(12) << asset.bytesUploaded / MB << "\n";
+        }
+        out.flush();
+    }
+
+private:
+    struct Asset
+    {
+        std::array<double, LOAD_PHASE_COUNT> phaseMs{};
+        uint64_t bytesRead = 0;
+        uint64_t bytesUploaded = 0;
+    };
+
+    static constexpr const char* phaseNames[LOAD_PHASE_COUNT] = {
+        "context", "glad", "shader compile", "assimp import", "processMesh", "image decode", "gpu upload", "mipmaps"
+    };
+
+    inline static bool enabled = false;
+    inline static std::mutex mutex;
+    inline static std::thread::id loadingThread;
+    // exclusive time per phase on the loading thread, and on every other thread
+    inline static std::array<double, LOAD_PHASE_COUNT> phaseMs{};
+    inline static std::array<double, LOAD_PHASE_COUNT> workerMs{};
+    inline static std::map<std::string, Asset> assets;
+
+    static double percent(double ms, double totalMs)
+    {
+        return totalMs > 0.0 ? ms * 100.0 / totalMs : 0.0;
+    }
+};
+
+// times the enclosing block as phase of asset, minus any LOAD_PHASE block nested in it on the same
+// thread. Without an asset the block is charged to the asset of the block around it.
+class LoadScope
+{
+public:
+    LoadScope(LoadPhase phase, const char* asset = nullptr)
+    {
+        if (!LoadReport::isEnabled())
+            return;
+        active = true;
+        this->phase = phase;
+        parent = current;
+        if (asset)
+            this->asset = asset;
+        else if (parent)
+            this->asset = parent->asset;
+        current = this;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~LoadScope()
+    {
+        if (!active)
+            return;
+        double ms = LoadReport::msSince(start);
+        LoadReport::add(phase, asset, ms - nestedMs);
+        if (parent)
+            parent->nestedMs += ms;
+        current = parent;
+    }
+
+    LoadScope(const LoadScope&) = delete;
+    LoadScope& operator=(const LoadScope&) = delete;
+
+    // asset of the innermost block on this thread, empty outside any
+    static const std::string& currentAsset()
+    {
+        static const std::string none;
+        return current ? current->asset : none;
+    }
+
+private:
+    inline static thread_local LoadScope* current = nullptr;
+    bool active = false;
+    LoadPhase phase = LOAD_CONTEXT;
+    std::string asset;
+    LoadScope* parent = nullptr;
+    double nestedMs = 0.0;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define LOAD_CONCAT_INNER(a, b) a##b
+#define LOAD_CONCAT(a, b) LOAD_CONCAT_INNER(a, b)
+// charges the rest of the block to phase (a LoadPhase) and, optionally, an asset name
+#define LOAD_PHASE(...) LoadScope LOAD_CONCAT(loadScope, __LINE__)(__VA_ARGS__)
+#endif
@@ -0,0 +1,535 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Memory accounting per subsystem and asset. Every allocation is charged to a MemoryTag, a
+// (subsystem, asset) pair such as ("model", "backpack/backpack.obj"):
+//
+// - CPU memory through TrackedAllocator, the allocator of the containers that hold asset data
+//   (Mesh's vertex and index arrays). Always on, an atomic add per allocation.
+// - GPU memory through interception of the GL entry points, like GLCounters: buffers by their
+//   glBufferData size, textures and renderbuffers from their internal format, size and mip chain,
+//   programs by their binary size. Only after installGL().
+//
+// The tag is taken from the innermost MEMORY_TAG scope on the calling thread when the container
+// or GL object is created, allocations outside any scope go to ("other", ""). The numbers are
+// estimates of what the driver keeps: unsized formats count as the sized format drivers pick
+// (GL_RGB as RGBA8), and nothing is known about alignment or driver-side shadow copies.
+struct MemoryTag
+{
+    std::string subsystem;
+    std::string asset;
+    std::atomic<int64_t> cpuBytes{0};
+    // GPU side, only touched on the GL thread
+    int64_t bufferBytes = 0;
+    int64_t textureBytes = 0;
+    int64_t renderbufferBytes = 0;
+    int64_t programBytes = 0;
+    int buffers = 0;
+    int textures = 0;
+    int programs = 0;
+
+    int64_t gpuBytes() const
+    {
+        return bufferBytes + textureBytes + renderbufferBytes + programBytes;
+    }
+};
+
+struct MemoryTotals
+{
+    int64_t cpuBytes = 0;
+    int64_t bufferBytes = 0;
+    int64_t textureBytes = 0;
+    int64_t renderbufferBytes = 0;
+    int64_t programBytes = 0;
+
+    int64_t gpuBytes() const
+    {
+        return bufferBytes + textureBytes + renderbufferBytes + programBytes;
+    }
+};
+
+class MemoryTracker
+{
+public:
+    // the tag for subsystem/asset, created on first use. Tags live until the program exits.
+    static MemoryTag* tag(const std::string &subsystem, const std::string &asset = "")
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        MemoryTag* &found = tagIndex[subsystem + '\n' + asset];
+        if (!found)
+        {
+            tags.emplace_back();
+            found = &tags.back();
+            found->subsystem = subsystem;
+            found->asset = asset;
+        }
+        return found;
+    }
+
+    // tag of the innermost MEMORY_TAG scope on this thread
+    static MemoryTag* current()
+    {
+        return currentTag ? currentTag : other();
+    }
+
+    static MemoryTag* other()
+    {
+        static MemoryTag* tagged = tag("other");
+        return tagged;
+    }
+
+    // call after gladLoadGLLoader and loadGLExtensions, before any GL object is created
+    static void installGL()
+    {
+        if (installed)
+            return;
+        installed = true;
+        wrap(glad_glActiveTexture, real.ActiveTexture, &ActiveTexture);
+        wrap(glad_glBindTexture, real.BindTexture, &BindTexture);
+        wrap(glad_glTexImage2D, real.TexImage2D, &TexImage2D);
+        wrap(glad_glGenerateMipmap, real.GenerateMipmap, &GenerateMipmap);
+        wrap(glad_glDeleteTextures, real.DeleteTextures, &DeleteTextures);
+        wrap(glad_glBindVertexArray, real.BindVertexArray, &BindVertexArray);
+        wrap(glad_glBindBuffer, real.BindBuffer, &BindBuffer);
+        wrap(glad_glBufferData, real.BufferData, &BufferData);
+        wrap(glad_glDeleteBuffers, real.DeleteBuffers, &DeleteBuffers);
+        wrap(glad_glBindRenderbuffer, real.BindRenderbuffer, &BindRenderbuffer);
+        wrap(glad_glRenderbufferStorage, real.RenderbufferStorage, &RenderbufferStorage);
+        wrap(glad_glDeleteRenderbuffers, real.DeleteRenderbuffers, &DeleteRenderbuffers);
+        wrap(glad_glCreateProgram, real.CreateProgram, &CreateProgram);
+        wrap(glad_glDeleteProgram, real.DeleteProgram, &DeleteProgram);
+    }
+
+    static bool isInstalled()
+    {
+        return installed;
+    }
+
+    // sum over all tags, or the tags of one subsystem
+    static MemoryTotals totals(const std::string &subsystem = "")
+    {
+        resolvePrograms();
+        MemoryTotals sum;
+        std::lock_guard<std::mutex> lock(tagMutex);
+        for (const MemoryTag &tag : tags)
+        {
+            if (!subsystem.empty() && tag.subsystem != subsystem)
+                continue;
+            sum.cpuBytes += tag.cpuBytes.load(std::memory_order_relaxed);
+            sum.bufferBytes += tag.bufferBytes;
+            sum.textureBytes += tag.textureBytes;
+            sum.renderbufferBytes += tag.renderbufferBytes;
+            sum.programBytes += tag.programBytes;
+        }
+        return sum;
+    }
+
+    // table of every tag that holds memory, grouped by subsystem, largest first
+    static void report(std::ostream &out)
+    {
+        resolvePrograms();
+        std::lock_guard<std::mutex> lock(tagMutex);
+        std::vector<const MemoryTag*> rows;
+        std::map<std::string, int64_t> subsystemBytes;
+        for (const MemoryTag &tag : tags)
+        {
+            int64_t bytes = tag.cpuBytes.load(std::memory_order_relaxed) + tag.gpuBytes();
+            if (bytes == 0 && tag.buffers == 0 && tag.textures == 0 && tag.programs == 0)
+                continue;
+            rows.push_back(&tag);
+            subsystemBytes[tag.subsystem] += bytes;
+        }
+        std::sort(rows.begin(), rows.end(), [&](const MemoryTag* a, const MemoryTag* b) {
+            if (a->subsystem != b->subsystem)
+                return subsystemBytes[a->subsystem] > subsystemBytes[b->subsystem];
+            return a->cpuBytes.load(std::memory_order_relaxed) + a->gpuBytes() > b->cpuBytes.load(std::memory_order_relaxed) + b->gpuBytes();
+        });
+
+        const double MB = 1024.0 * 1024.0;
+        MemoryTotals sum;
+        out << std::fixed << std::setprecision(2);
+        out << "memory (MB)" << (installed ? "" : ", GPU side not tracked") << std::endl;
+        out << std::left << std::setw(12) << "subsystem" << std::setw(36) << "asset" << std::right
+            << std::setw(9) << "cpu" << std::setw(9) << "buffers" << std::setw(9) << "textures"
+            << std::setw(9) << "rbuffers" << std::setw(9) << "programs" << std::endl;
+        for (const MemoryTag* tag : rows)
+        {
+            int64_t cpu = tag->cpuBytes.load(std::memory_order_relaxed);
+            std::string asset = tag->asset.size() > 35 ? "..." + tag->asset.substr(tag->asset.size() - 32) : tag->asset;
+            out << std::left << std::setw(12) << tag->subsystem << std::setw(36) << asset << std::right
+                << std::setw(9) << cpu / MB << std::setw(9) << tag->bufferBytes / MB
+                << std::setw(9) << tag->textureBytes / MB << std::setw(9) << tag->renderbufferBytes / MB
+                << std::setw(9) << tag->programBytes / MB << std::endl;
+            sum.cpuBytes += cpu;
+            sum.bufferBytes += tag->bufferBytes;
+            sum.textureBytes += tag->textureBytes;
+            sum.renderbufferBytes += tag->renderbufferBytes;
+            sum.programBytes += tag->programBytes;
+        }
+        out << std::left << std::setw(48) << "total" << std::right << std::setw(9) << sum.cpuBytes / MB
+            << std::setw(9) << sum.bufferBytes / MB << std::setw(9) << sum.textureBytes / MB
+            << std::setw(9) << sum.renderbufferBytes / MB << std::setw(9) << sum.programBytes / MB << std::endl;
+        out << "gpu total " << sum.gpuBytes() / MB << " MB, cpu total " << sum.cpuBytes / MB << " MB" << std::endl;
+        out.unsetf(std::ios::floatfield);
+        out << std::setprecision(6);
+    }
+
+    // bytes per texel drivers typically store for internalFormat
+    static int64_t texelBytes(GLint internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GL_RED: case GL_R8: case GL_STENCIL_INDEX8:
+                return 1;
+            case GL_RG: case GL_RG8: case GL_R16F: case GL_R16: case GL_DEPTH_COMPONENT16:
+                return 2;
+            case GL_RGB16F: case GL_RGBA16F: case GL_RG32F: case GL_RGBA16:
+                return 8;
+            case GL_RGB32F: case GL_RGBA32F:
+                return 16;
+        }
+        // GL_RGB(A), RGB(A)8, sRGB, R32F, RG16F, packed formats and depth/stencil: 4, RGB padded to RGBA
+        return 4;
+    }
+
+    // bytes of a width x height image with levels mip levels (0: the full chain)
+    static int64_t imageBytes(int64_t width, int64_t height, int64_t texel, int levels)
+    {
+        int64_t bytes = 0;
+        for (int level = 0; levels == 0 || level < levels; level++)
+        {
+            bytes += std::max<int64_t>(width >> level, 1) * std::max<int64_t>(height >> level, 1) * texel;
+            if ((width >> level) <= 1 && (height >> level) <= 1)
+                break;
+        }
+        return bytes;
+    }
+
+private:
+    friend class MemoryScope;
+
+    struct Real
+    {
+        PFNGLACTIVETEXTUREPROC ActiveTexture;
+        PFNGLBINDTEXTUREPROC BindTexture;
+        PFNGLTEXIMAGE2DPROC TexImage2D;
+        PFNGLGENERATEMIPMAPPROC GenerateMipmap;
+        PFNGLDELETETEXTURESPROC DeleteTextures;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+        PFNGLBINDBUFFERPROC BindBuffer;
+        PFNGLBUFFERDATAPROC BufferData;
+        PFNGLDELETEBUFFERSPROC DeleteBuffers;
+        PFNGLBINDRENDERBUFFERPROC BindRenderbuffer;
+        PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage;
+        PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers;
+        PFNGLCREATEPROGRAMPROC CreateProgram;
+        PFNGLDELETEPROGRAMPROC DeleteProgram;
+    };
+
+    // one GL object and what it is charged for
+    struct Resource
+    {
+        MemoryTag* tag = nullptr;
+        int64_t bytes = 0;
+        // textures: level 0 size, to size the chain glGenerateMipmap builds
+        int width = 0, height = 0;
+        int64_t texel = 0;
+    };
+
+    inline static std::mutex tagMutex;
+    inline static std::deque<MemoryTag> tags;
+    inline static std::unordered_map<std::string, MemoryTag*> tagIndex;
+    inline static thread_local MemoryTag* currentTag = nullptr;
+
+    inline static bool installed = false;
+    inline static Real real{};
+    inline static std::unordered_map<GLuint, Resource> textures, buffers, renderbuffers, programs;
+    // programs whose binary size hasn't been read yet
+    inline static std::vector<GLuint> unsizedPrograms;
+
+    // bindings needed to know which object an allocation call is for
+    inline static GLuint activeUnit = 0;
+    inline static std::unordered_map<GLuint, GLuint> textures2D;           // unit -> texture
+    inline static std::unordered_map<GLenum, GLuint> boundBuffers;         // target -> buffer
+    inline static std::unordered_map<GLuint, GLuint> elementBuffers;       // vertex array -> index buffer
+    inline static GLuint vertexArray = 0;
+    inline static GLuint renderbuffer = 0;
+
+    template <typename Fn>
+    static void wrap(Fn &slot, Fn &saved, Fn wrapper)
+    {
+        saved = slot;
+        if (slot)
+            slot = wrapper;
+    }
+
+    // the record for name, charged to the current tag the first time storage is given to it
+    static Resource& resource(std::unordered_map<GLuint, Resource> &objects, GLuint name, int MemoryTag::*count)
+    {
+        Resource &found = objects[name];
+        if (!found.tag)
+        {
+            found.tag = current();
+            found.tag->*count += 1;
+        }
+        return found;
+    }
+
+    static void charge(Resource &resource, int64_t MemoryTag::*field, int64_t bytes)
+    {
+        resource.tag->*field += bytes - resource.bytes;
+        resource.bytes = bytes;
+    }
+
+    static void forget(std::unordered_map<GLuint, Resource> &objects, GLuint name, int64_t MemoryTag::*field, int MemoryTag::*count)
+    {
+        auto found = objects.find(name);
+        if (found == objects.end())
+            return;
+        found->second.tag->*field -= found->second.bytes;
+        found->second.tag->*count -= 1;
+        objects.erase(found);
+    }
+
+    // program binary sizes are only known once linking finished, read them when somebody asks
+    static void resolvePrograms()
+    {
+        if (!installed || unsizedPrograms.empty() || !glExt.programBinary)
+            return;
+        std::vector<GLuint> pending;
+        for (GLuint program : unsizedPrograms)
+        {
+            auto found = programs.find(program);
+            if (found == programs.end())
+                continue;
+            if (glExt.parallelShaderCompile)
+            {
+                GLint done = GL_FALSE;
+                glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+                if (!done)
+                {
+                    pending.push_back(program);
+                    continue;
+                }
+            }
+            GLint length = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            charge(found->second, &MemoryTag::programBytes, length);
+        }
+        unsizedPrograms.swap(pending);
+    }
+
+    // textures
+    static void APIENTRY ActiveTexture(GLenum unit)
+    {
+        activeUnit = unit - GL_TEXTURE0;
+        real.ActiveTexture(unit);
+    }
+    static void APIENTRY BindTexture(GLenum target, GLuint name)
+    {
+        if (target == GL_TEXTURE_2D)
+            textures2D[activeUnit] = name;
+        real.BindTexture(target, name);
+    }
+    static void APIENTRY TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+    {
+        GLuint name = textures2D[activeUnit];
+        if (target == GL_TEXTURE_2D && name)
+        {
+            Resource &texture = resource(textures, name, &MemoryTag::textures);
+            int64_t texel = texelBytes(internalFormat);
+            if (level == 0)
+            {
+                texture.width = width;
+                texture.height = height;
+                texture.texel = texel;
+                charge(texture, &MemoryTag::textureBytes, imageBytes(width, height, texel, 1));
+            }
+            else
+                charge(texture, &MemoryTag::textureBytes, texture.bytes + imageBytes(width, height, texel, 1));
+        }
+        real.TexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+    }
+    static void APIENTRY GenerateMipmap(GLenum target)
+    {
+        GLuint name = textures2D[activeUnit];
+        if (target == GL_TEXTURE_2D && name && textures.count(name))
+        {
+            Resource &texture = textures[name];
+            charge(texture, &MemoryTag::textureBytes, imageBytes(texture.width, texture.height, texture.texel, 0));
+        }
+        real.GenerateMipmap(target);
+    }
+    static void APIENTRY DeleteTextures(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+        {
+            forget(textures, names[i], &MemoryTag::textureBytes, &MemoryTag::textures);
+            for (auto &binding : textures2D)
+                if (binding.second == names[i])
+                    binding.second = 0;
+        }
+        real.DeleteTextures(n, names);
+    }
+
+    // buffers. The index buffer binding belongs to the vertex array.
+    static void APIENTRY BindVertexArray(GLuint name)
+    {
+        vertexArray = name;
+        real.BindVertexArray(name);
+    }
+    static void APIENTRY BindBuffer(GLenum target, GLuint name)
+    {
+        if (target == GL_ELEMENT_ARRAY_BUFFER)
+            elementBuffers[vertexArray] = name;
+        else
+            boundBuffers[target] = name;
+        real.BindBuffer(target, name);
+    }
+    static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+    {
+        GLuint name = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffers[vertexArray] : boundBuffers[target];
+        if (name)
+            charge(resource(buffers, name, &MemoryTag::buffers), &MemoryTag::bufferBytes, size);
+        real.BufferData(target, size, data, usage);
+    }
+    static void APIENTRY DeleteBuffers(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+        {
+            forget(buffers, names[i], &MemoryTag::bufferBytes, &MemoryTag::buffers);
+            for (auto &binding : boundBuffers)
+                if (binding.second == names[i])
+                    binding.second = 0;
+            for (auto &binding : elementBuffers)
+                if (binding.second == names[i])
+                    binding.second = 0;
+        }
+        real.DeleteBuffers(n, names);
+    }
+
+    // renderbuffers, counted with the textures
+    static void APIENTRY BindRenderbuffer(GLenum target, GLuint name)
+    {
+        renderbuffer = name;
+        real.BindRenderbuffer(target, name);
+    }
+    static void APIENTRY RenderbufferStorage(GLenum target, GLenum internalFormat, GLsizei width, GLsizei height)
+    {
+        if (renderbuffer)
+            charge(resource(renderbuffers, renderbuffer, &MemoryTag::textures), &MemoryTag::renderbufferBytes,
+                   imageBytes(width, height, texelBytes(internalFormat), 1));
+        real.RenderbufferStorage(target, internalFormat, width, height);
+    }
+    static void APIENTRY DeleteRenderbuffers(GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+        {
+            forget(renderbuffers, names[i], &MemoryTag::renderbufferBytes, &MemoryTag::textures);
+            if (renderbuffer == names[i])
+                renderbuffer = 0;
+        }
+        real.DeleteRenderbuffers(n, names);
+    }
+
+    // programs
+    static GLuint APIENTRY CreateProgram()
+    {
+        GLuint name = real.CreateProgram();
+        if (name)
+        {
+            resource(programs, name, &MemoryTag::programs);
+            unsizedPrograms.push_back(name);
+        }
+        return name;
+    }
+    static void APIENTRY DeleteProgram(GLuint name)
+    {
+        forget(programs, name, &MemoryTag::programBytes, &MemoryTag::programs);
+        real.DeleteProgram(name);
+    }
+};
+
+// charges allocations made on this thread inside the enclosing block to a tag
+class MemoryScope
+{
+public:
+    explicit MemoryScope(MemoryTag* tag) : previous(MemoryTracker::currentTag)
+    {
+        MemoryTracker::currentTag = tag;
+    }
+
+    ~MemoryScope()
+    {
+        MemoryTracker::currentTag = previous;
+    }
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryTag* previous;
+};
+
+// std allocator that charges what it allocates to a MemoryTag, the tag of the innermost
+// MEMORY_TAG scope when the container is created. Copies of a container keep its tag.
+template <typename T>
+class TrackedAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    TrackedAllocator() : tag(MemoryTracker::current()) {}
+    explicit TrackedAllocator(MemoryTag* tag) : tag(tag) {}
+    template <typename U>
+    TrackedAllocator(const TrackedAllocator<U> &other) : tag(other.tag) {}
+
+    T* allocate(std::size_t n)
+    {
+        tag->cpuBytes.fetch_add((int64_t)(n * sizeof(T)), std::memory_order_relaxed);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        tag->cpuBytes.fetch_sub((int64_t)(n * sizeof(T)), std::memory_order_relaxed);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const TrackedAllocator<U> &other) const { return tag == other.tag; }
+    template <typename U>
+    bool operator!=(const TrackedAllocator<U> &other) const { return tag != other.tag; }
+
+    MemoryTag* tag;
+};
+
+template <typename T>
+using TrackedVector = std::vector<T, TrackedAllocator<T>>;
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+// charges the rest of the block's allocations to (subsystem, asset)
+#define MEMORY_TAG(subsystem, asset) MemoryScope MEMORY_CONCAT(memoryScope, __LINE__)(MemoryTracker::tag(subsystem, asset))
+#endif
@@ -7,7 +7,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Shader.h"
+#include "MemoryTracker.h"
+#include "LoadReport.h"
+#include "UploadQueue.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -40,26 +44,55 @@ struct Texture {
 
 class Mesh {
 public:
-    // mesh Data
-    vector<Vertex>       vertices;
-    vector<unsigned int> indices;
-    vector<Texture>      textures;
+    // mesh Data, charged to the MEMORY_TAG active when the mesh is created
+    TrackedVector<Vertex>       vertices;
+    TrackedVector<unsigned int> indices;
+    vector<Texture>             textures;
+    // position-only copy of the vertex stream for the depth pre-pass
+    TrackedVector<glm::vec3>    positions;
     unsigned int VAO_bp;
+    unsigned int VAO_depth;
+    // buffer data still in the upload queue, the mesh isn't drawn until it's done
+    std::shared_ptr<UploadTicket> uploads;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
     {
-        this->vertices = vertices;
-        this->indices = indices;
+        this->vertices.assign(vertices.begin(), vertices.end());
+        this->indices.assign(indices.begin(), indices.end());
         this->textures = textures;
+        positions.reserve(vertices.size());
+        for (const Vertex &vertex : vertices)
+            positions.push_back(vertex.Position);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
+
+    // constructor taking over data that is already in tracked storage, e.g. converted by Model on
+    // worker threads, without copying it
+    Mesh(TrackedVector<Vertex> &&vertices, TrackedVector<unsigned int> &&indices, vector<Texture> textures, TrackedVector<glm::vec3> &&positions)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), positions(std::move(positions))
+    {
+        setupMesh();
+    }
+
+    // constructor for callers that already built the position stream alongside the vertices
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<glm::vec3> positions)
+    {
+        this->vertices.assign(vertices.begin(), vertices.end());
+        this->indices.assign(indices.begin(), indices.end());
+        this->textures = textures;
+        this->positions.assign(positions.begin(), positions.end());
+
+        setupMesh();
+    }
     
     // render the mesh
     void Draw(Shader &shader)
     {
+        if (uploads && !uploads->done())
+            return;
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
@@ -97,13 +130,38 @@ public:
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render positions only, for the depth pre-pass. No textures or material uniforms involved.
+    void DrawDepth()
+    {
+        if (uploads && !uploads->done())
+            return;
+        glBindVertexArray(VAO_depth);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    // frees the GL objects; call while the context is still current. Copies share the same names,
+    // so only one of them may release.
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO_bp);
+        glDeleteVertexArrays(1, &VAO_depth);
+        glDeleteBuffers(1, &VBO_bp);
+        glDeleteBuffers(1, &EBO_bp);
+        glDeleteBuffers(1, &VBO_depth);
+        VAO_bp = VAO_depth = VBO_bp = EBO_bp = VBO_depth = 0;
+    }
+
 private:
     // render data
-    unsigned int VBO_bp, EBO_bp;
+    unsigned int VBO_bp, EBO_bp, VBO_depth;
 
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
+        // charged to the model being loaded
+        LOAD_PHASE(LOAD_GPU_UPLOAD);
+        LoadReport::addBytesUploaded(LoadScope::currentAsset(), vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) + positions.size() * sizeof(glm::vec3));
         // create buffers/arrays
         glGenVertexArrays(1, &VAO_bp);
         glGenBuffers(1, &VBO_bp);
@@ -113,10 +171,10 @@ private:
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO_bp);
         
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        bufferData(GL_ARRAY_BUFFER, VBO_bp, vertices.size() * sizeof(Vertex), &vertices[0]);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_bp);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        bufferData(GL_ELEMENT_ARRAY_BUFFER, EBO_bp, indices.size() * sizeof(unsigned int), &indices[0]);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -142,6 +200,32 @@ private:
         glEnableVertexAttribArray(6);
         glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
         glBindVertexArray(0);
+
+        // tightly packed positions sharing the same index buffer, so the depth pass fetches
+        // 12 bytes per vertex instead of the whole Vertex
+        glGenVertexArrays(1, &VAO_depth);
+        glGenBuffers(1, &VBO_depth);
+        glBindVertexArray(VAO_depth);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_depth);
+        bufferData(GL_ARRAY_BUFFER, VBO_depth, positions.size() * sizeof(glm::vec3), &positions[0]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_bp);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glBindVertexArray(0);
+    }
+
+    // fills the bound buffer, or with the upload queue running sizes it and leaves the data to the queue
+    void bufferData(GLenum target, GLuint buffer, size_t bytes, const void *data)
+    {
+        if (!UploadQueue::get().isRunning())
+        {
+            glBufferData(target, bytes, data, GL_STATIC_DRAW);
+            return;
+        }
+        glBufferData(target, bytes, NULL, GL_STATIC_DRAW);
+        if (!uploads)
+            uploads = std::make_shared<UploadTicket>();
+        UploadQueue::get().uploadBuffer(buffer, data, bytes, uploads);
     }
 };
 #endif
@@ -12,11 +12,18 @@
 
 #include "Mesh.h"
 #include "Shader.h"
+#include "Profiler.h"
+#include "HitchDetector.h"
+#include "MemoryTracker.h"
+#include "LoadReport.h"
+#include "JobSystem.h"
+#include "UploadQueue.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <vector>
 using namespace std;
@@ -31,6 +38,9 @@ public:
     vector<Mesh> meshes;
     string directory;
     bool gammaCorrection;
+    // bounding sphere in model space, used for screen-size based lighting LOD
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
@@ -41,17 +51,40 @@ public:
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        PROFILE_SCOPE("Model::Draw");
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws positions only, for the depth pre-pass
+    void DrawDepth()
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawDepth();
+    }
     
 private:
+    // the microbenchmarks feed processMesh synthetic meshes without going through a file
+    friend struct ModelMicrobench;
+    Model() : gammaCorrection(false) {}
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
+        PROFILE_SCOPE_DETAIL("Model::loadModel", path.c_str());
+        HITCH_SCOPE("asset load", path.c_str());
+        MEMORY_TAG("model", path);
+        // everything below that isn't the import, a texture load or an upload is mesh conversion
+        LOAD_PHASE(LOAD_PROCESS_MESH, path.c_str());
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene;
+        {
+            LOAD_PHASE(LOAD_ASSIMP_IMPORT);
+            if (LoadReport::isEnabled())
+                LoadReport::addBytesRead(path, LoadReport::fileSize(path));
+            scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        }
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
@@ -61,87 +94,162 @@ private:
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        processScene(scene);
+        computeBounds();
+    }
+
+    // CPU side of one mesh, converted on any thread into storage charged to the model
+    struct MeshData
+    {
+        TrackedVector<Vertex> vertices;
+        TrackedVector<unsigned int> indices;
+        TrackedVector<glm::vec3> positions;
+    };
+
+    // vertices or triangles per conversion job; smaller meshes are converted by a single job
+    static constexpr size_t CONVERT_GRAIN = 16384;
+
+    // converts every mesh of the scene in node order. Conversion runs on the job system, across
+    // meshes and across vertex ranges within a large mesh, while this thread loads the material
+    // textures; then the GL buffers are created here, one mesh after another.
+    void processScene(const aiScene *scene)
+    {
+        vector<aiMesh*> order;
+        processNode(scene->mRootNode, scene, order);
+
+        // allocated here so the storage is charged to this thread's MEMORY_TAG
+        vector<MeshData> data(order.size());
+        JobCounter converted;
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            aiMesh *mesh = order[i];
+            MeshData &out = data[i];
+            JobSystem::get().run([mesh, &out] { convertMesh(mesh, out); }, &converted);
+        }
+        vector<vector<Texture>> textures(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            textures[i] = loadMeshTextures(order[i], scene);
+        JobSystem::get().wait(converted);
+
+        meshes.reserve(meshes.size() + order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            meshes.emplace_back(std::move(data[i].vertices), std::move(data[i].indices), std::move(textures[i]), std::move(data[i].positions));
+    }
+
+    // fits a sphere around the axis aligned bounds of all meshes
+    void computeBounds()
+    {
+        glm::vec3 lo(std::numeric_limits<float>::max());
+        glm::vec3 hi(-std::numeric_limits<float>::max());
+        for (const Mesh &mesh : meshes)
+            for (const Vertex &vertex : mesh.vertices)
+            {
+                lo = glm::min(lo, vertex.Position);
+                hi = glm::max(hi, vertex.Position);
+            }
+        if (meshes.empty())
+            return;
+        boundsCenter = (lo + hi) * 0.5f;
+        boundsRadius = glm::length(hi - boundsCenter);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+    void processNode(aiNode *node, const aiScene *scene, vector<aiMesh*> &order)
     {
-        // process each mesh located at the current node
+        // collect each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            order.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        // after we've collected all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, order);
         }
 
     }
 
+    // one mesh on its own: conversion, textures and GL buffers
     Mesh processMesh(aiMesh *mesh, const aiScene *scene)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        convertMesh(mesh, data);
+        vector<Texture> textures = loadMeshTextures(mesh, scene);
+        // return a mesh object created from the extracted mesh data
+        return Mesh(std::move(data.vertices), std::move(data.indices), std::move(textures), std::move(data.positions));
+    }
 
+    // fills out's presized arrays from the aiMesh. No GL calls, safe on any thread; large meshes
+    // are split into vertex and triangle ranges on the job system.
+    static void convertMesh(const aiMesh *mesh, MeshData &out)
+    {
+        out.vertices.resize(mesh->mNumVertices);
+        out.positions.resize(mesh->mNumVertices);
         // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+        JobSystem::get().parallelFor(mesh->mNumVertices, [mesh, &out](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                Vertex &vertex = out.vertices[i];
+                // assimp uses its own vector class that doesn't directly convert to glm's vec3 class
+                // positions
+                vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+                // normals
+                if (mesh->HasNormals())
+                    vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+                // texture coordinates
+                if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+                {
+                    // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+                    // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+                    vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+                    // tangent
+                    vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                    // bitangent
+                    vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+                }
+                out.positions[i] = vertex.Position;
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+        }, CONVERT_GRAIN);
 
-            vertices.push_back(vertex);
+        // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        {
+            // triangles only, which aiProcess_Triangulate leaves unless there are points or lines:
+            // face i lands at 3 * i
+            out.indices.resize((size_t)mesh->mNumFaces * 3);
+            JobSystem::get().parallelFor(mesh->mNumFaces, [mesh, &out](size_t begin, size_t end) {
+                unsigned int *index = &out.indices[begin * 3];
+                for (size_t i = begin; i < end; i++, index += 3)
+                {
+                    const unsigned int *face = mesh->mFaces[i].mIndices;
+                    index[0] = face[0];
+                    index[1] = face[1];
+                    index[2] = face[2];
+                }
+            }, CONVERT_GRAIN);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        else
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            size_t count = 0;
+            for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+                count += mesh->mFaces[i].mNumIndices;
+            out.indices.resize(count);
+            unsigned int *index = out.indices.data();
+            for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+            {
+                // retrieve all indices of the face and store them in the indices vector
+                const aiFace &face = mesh->mFaces[i];
+                index = std::copy(face.mIndices, face.mIndices + face.mNumIndices, index);
+            }
         }
+    }
+
+    // loads the material textures of a mesh, GL calls so only on the thread with the context
+    vector<Texture> loadMeshTextures(const aiMesh *mesh, const aiScene *scene)
+    {
+        vector<Texture> textures;
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -163,9 +271,7 @@ private:
         // 4. height maps
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return textures;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -205,14 +311,29 @@ private:
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
 {
+    PROFILE_SCOPE_DETAIL("TextureFromFile", path);
+    HITCH_SCOPE("texture load", path);
     string filename = string(path);
     filename = directory + '/' + filename;
+    MEMORY_TAG("texture", filename);
+
+    // decode and mipmaps are split out below, the rest is upload
+    LOAD_PHASE(LOAD_GPU_UPLOAD, filename.c_str());
+    // streamed in over the next frames, decoded on the job system
+    if (UploadQueue::get().isRunning())
+        return UploadQueue::get().loadTexture(filename);
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    unsigned char *data;
+    {
+        LOAD_PHASE(LOAD_IMAGE_DECODE);
+        if (LoadReport::isEnabled())
+            LoadReport::addBytesRead(filename, LoadReport::fileSize(filename));
+        data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    }
     if (data)
     {
         GLenum format;
@@ -225,7 +346,11 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
 
         glBindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        LoadReport::addBytesUploaded(filename, (uint64_t)width * height * nrComponents);
+        {
+            LOAD_PHASE(LOAD_MIPMAPS);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -0,0 +1,433 @@
+#ifndef NULL_GL_H
+#define NULL_GL_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Null GL backend (--null). Every GL call in the app already goes through glad's function pointer
+// table, so the backend is a glad loader: gladLoadGLLoader(NullGL::loader) fills the table with
+// the implementations below and no context, window or GPU is needed.
+//
+// The implementations keep just enough state to validate their arguments the way a driver would
+// (names must come from glGen*, draws need a program and a vertex array, uniform locations must
+// belong to the current program, buffer updates must fit the buffer) and count what fails. They
+// don't render anything. Entry points without a null implementation resolve to a no-op. Every
+// entry point the app reads a result from is implemented. Statistics come from GLCounters, which
+// can be installed on top as usual.
+
+class NullGL
+{
+public:
+    // GLADloadproc handing out the null implementations
+    static void* loader(const char *name)
+    {
+        static const std::unordered_map<std::string, void*> table = {
+            { "glGetString", (void*)&GetString },
+            { "glGetStringi", (void*)&GetStringi },
+            { "glGetIntegerv", (void*)&GetIntegerv },
+            { "glGetError", (void*)&GetError },
+            { "glGenBuffers", (void*)&GenBuffers },
+            { "glGenVertexArrays", (void*)&GenVertexArrays },
+            { "glGenTextures", (void*)&GenTextures },
+            { "glGenFramebuffers", (void*)&GenFramebuffers },
+            { "glGenRenderbuffers", (void*)&GenRenderbuffers },
+            { "glGenQueries", (void*)&GenQueries },
+            { "glCreateShader", (void*)&CreateShader },
+            { "glCreateProgram", (void*)&CreateProgram },
+            { "glDeleteBuffers", (void*)&DeleteBuffers },
+            { "glDeleteVertexArrays", (void*)&DeleteVertexArrays },
+            { "glDeleteTextures", (void*)&DeleteTextures },
+            { "glDeleteFramebuffers", (void*)&DeleteFramebuffers },
+            { "glDeleteRenderbuffers", (void*)&DeleteRenderbuffers },
+            { "glDeleteQueries", (void*)&DeleteQueries },
+            { "glDeleteShader", (void*)&DeleteShader },
+            { "glDeleteProgram", (void*)&DeleteProgram },
+            { "glBindBuffer", (void*)&BindBuffer },
+            { "glBindVertexArray", (void*)&BindVertexArray },
+            { "glBindTexture", (void*)&BindTexture },
+            { "glActiveTexture", (void*)&ActiveTexture },
+            { "glBindFramebuffer", (void*)&BindFramebuffer },
+            { "glBindRenderbuffer", (void*)&BindRenderbuffer },
+            { "glUseProgram", (void*)&UseProgram },
+            { "glBufferData", (void*)&BufferData },
+            { "glBufferSubData", (void*)&BufferSubData },
+            { "glMapBufferRange", (void*)&MapBufferRange },
+            { "glUnmapBuffer", (void*)&UnmapBuffer },
+            { "glTexImage2D", (void*)&TexImage2D },
+            { "glCheckFramebufferStatus", (void*)&CheckFramebufferStatus },
+            { "glGetShaderiv", (void*)&GetShaderiv },
+            { "glGetShaderInfoLog", (void*)&GetInfoLog },
+            { "glGetProgramiv", (void*)&GetProgramiv },
+            { "glGetProgramInfoLog", (void*)&GetInfoLog },
+            { "glGetUniformLocation", (void*)&GetUniformLocation },
+            { "glGetUniformBlockIndex", (void*)&GetUniformLocation },
+            { "glUniform1i", (void*)&Uniform1i },
+            { "glUniform1f", (void*)&Uniform1f },
+            { "glUniform2f", (void*)&Uniform2f },
+            { "glUniform3f", (void*)&Uniform3f },
+            { "glUniform4f", (void*)&Uniform4f },
+            { "glUniform2fv", (void*)&UniformFv },
+            { "glUniform3fv", (void*)&UniformFv },
+            { "glUniform4fv", (void*)&UniformFv },
+            { "glUniformMatrix2fv", (void*)&UniformMatrixFv },
+            { "glUniformMatrix3fv", (void*)&UniformMatrixFv },
+            { "glUniformMatrix4fv", (void*)&UniformMatrixFv },
+            { "glGetQueryObjectiv", (void*)&GetQueryObjectiv },
+            { "glGetQueryObjectuiv", (void*)&GetQueryObjectuiv },
+            { "glGetQueryObjectui64v", (void*)&GetQueryObjectui64v },
+            { "glFenceSync", (void*)&FenceSync },
+            { "glClientWaitSync", (void*)&ClientWaitSync },
+            { "glDrawArrays", (void*)&DrawArrays },
+            { "glDrawElements", (void*)&DrawElements },
+            { "glDrawArraysInstanced", (void*)&DrawArraysInstanced },
+            { "glDrawElementsInstanced", (void*)&DrawElementsInstanced },
+        };
+        auto it = table.find(name);
+        return it != table.end() ? it->second : (void*)&Noop;
+    }
+
+    // calls that a driver would have rejected
+    static uint64_t errorCount()
+    {
+        return errors;
+    }
+
+private:
+    struct Program
+    {
+        std::unordered_map<std::string, GLint> locations;
+    };
+
+    inline static GLuint nextName = 1;
+    inline static std::unordered_set<GLuint> buffers, vertexArrays, textures, framebuffers, renderbuffers, queries, shaders;
+    inline static std::unordered_map<GLuint, Program> programs;
+    inline static std::unordered_map<GLuint, std::vector<char>> bufferData;
+    inline static std::unordered_map<GLenum, GLuint> boundBuffers;
+    inline static std::unordered_map<GLuint, GLuint> elementBuffers;    // per vertex array
+    inline static GLuint vertexArray = 0;
+    inline static GLuint program = 0;
+    inline static GLuint activeUnit = 0;
+    inline static uint64_t errors = 0;
+
+    static void error(const char *function, const std::string &what)
+    {
+        // the first few are enough to find the call site, the count says how widespread it is
+        if (errors++ < 20)
+            std::cout << "ERROR::NULLGL::" << function << ": " << what << std::endl;
+    }
+
+    static void generate(std::unordered_set<GLuint> &set, const char *function, GLsizei n, GLuint *names)
+    {
+        if (n < 0)
+            return error(function, "negative count");
+        for (GLsizei i = 0; i < n; i++)
+            set.insert(names[i] = nextName++);
+    }
+
+    static void remove(std::unordered_set<GLuint> &set, GLsizei n, const GLuint *names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+            set.erase(names[i]);
+    }
+
+    static bool known(const std::unordered_set<GLuint> &set, GLuint name, const char *function)
+    {
+        if (name == 0 || set.count(name))
+            return true;
+        error(function, "unknown name " + std::to_string(name));
+        return false;
+    }
+
+    static bool validUniform(GLint location, const char *function)
+    {
+        if (location == -1)
+            return true;
+        auto it = programs.find(program);
+        if (it == programs.end())
+        {
+            error(function, "no program in use");
+            return false;
+        }
+        if (location < 0 || location >= (GLint)it->second.locations.size())
+        {
+            error(function, "location " + std::to_string(location) + " not in the current program");
+            return false;
+        }
+        return true;
+    }
+
+    static bool validDraw(const char *function, GLsizei count)
+    {
+        if (count < 0)
+            error(function, "negative count");
+        else if (program == 0)
+            error(function, "no program in use");
+        else if (vertexArray == 0)
+            error(function, "no vertex array bound");
+        else
+            return true;
+        return false;
+    }
+
+    static void APIENTRY Noop() {}
+
+    // queries
+    static const GLubyte* APIENTRY GetString(GLenum name)
+    {
+        switch (name)
+        {
+            case GL_VERSION: return (const GLubyte*)"3.3 NullGL";
+            case GL_VENDOR: return (const GLubyte*)"none";
+            case GL_RENDERER: return (const GLubyte*)"NullGL";
+            case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte*)"3.30";
+        }
+        return (const GLubyte*)"";
+    }
+    // glad's loader fails on a 3.x context that reports no extensions at all, so report one
+    static const GLubyte* APIENTRY GetStringi(GLenum, GLuint)
+    {
+        return (const GLubyte*)"GL_NULL_backend";
+    }
+    static void APIENTRY GetIntegerv(GLenum pname, GLint *data)
+    {
+        *data = 0;
+        if (pname == GL_MAJOR_VERSION || pname == GL_MINOR_VERSION || pname == GL_NUM_EXTENSIONS)
+            *data = pname == GL_NUM_EXTENSIONS ? 1 : 3;
+        else if (pname == GL_CURRENT_PROGRAM)
+            *data = (GLint)program;
+        else if (pname == GL_MAX_TEXTURE_IMAGE_UNITS || pname == GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS)
+            *data = 32;
+    }
+    static GLenum APIENTRY GetError()
+    {
+        return GL_NO_ERROR;
+    }
+    static GLenum APIENTRY CheckFramebufferStatus(GLenum)
+    {
+        return GL_FRAMEBUFFER_COMPLETE;
+    }
+    static void APIENTRY GetQueryObjectiv(GLuint, GLenum pname, GLint *value) { *value = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0; }
+    static void APIENTRY GetQueryObjectuiv(GLuint, GLenum pname, GLuint *value) { *value = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0; }
+    static void APIENTRY GetQueryObjectui64v(GLuint, GLenum, GLuint64 *value) { *value = 0; }
+    static GLsync APIENTRY FenceSync(GLenum, GLbitfield)
+    {
+        static int fence;
+        return (GLsync)&fence;
+    }
+    static GLenum APIENTRY ClientWaitSync(GLsync, GLbitfield, GLuint64)
+    {
+        return GL_ALREADY_SIGNALED;
+    }
+
+    // objects
+    static void APIENTRY GenBuffers(GLsizei n, GLuint *v) { generate(buffers, "glGenBuffers", n, v); }
+    static void APIENTRY GenVertexArrays(GLsizei n, GLuint *v) { generate(vertexArrays, "glGenVertexArrays", n, v); }
+    static void APIENTRY GenTextures(GLsizei n, GLuint *v) { generate(textures, "glGenTextures", n, v); }
+    static void APIENTRY GenFramebuffers(GLsizei n, GLuint *v) { generate(framebuffers, "glGenFramebuffers", n, v); }
+    static void APIENTRY GenRenderbuffers(GLsizei n, GLuint *v) { generate(renderbuffers, "glGenRenderbuffers", n, v); }
+    static void APIENTRY GenQueries(GLsizei n, GLuint *v) { generate(queries, "glGenQueries", n, v); }
+    static GLuint APIENTRY CreateShader(GLenum)
+    {
+        shaders.insert(nextName);
+        return nextName++;
+    }
+    static GLuint APIENTRY CreateProgram()
+    {
+        programs[nextName];
+        return nextName++;
+    }
+    static void APIENTRY DeleteBuffers(GLsizei n, const GLuint *v)
+    {
+        remove(buffers, n, v);
+        for (GLsizei i = 0; i < n; i++)
+            bufferData.erase(v[i]);
+    }
+    static void APIENTRY DeleteVertexArrays(GLsizei n, const GLuint *v)
+    {
+        remove(vertexArrays, n, v);
+        for (GLsizei i = 0; i < n; i++)
+        {
+            elementBuffers.erase(v[i]);
+            if (vertexArray == v[i])
+                vertexArray = 0;
+        }
+    }
+    static void APIENTRY DeleteTextures(GLsizei n, const GLuint *v) { remove(textures, n, v); }
+    static void APIENTRY DeleteFramebuffers(GLsizei n, const GLuint *v) { remove(framebuffers, n, v); }
+    static void APIENTRY DeleteRenderbuffers(GLsizei n, const GLuint *v) { remove(renderbuffers, n, v); }
+    static void APIENTRY DeleteQueries(GLsizei n, const GLuint *v) { remove(queries, n, v); }
+    static void APIENTRY DeleteShader(GLuint s) { shaders.erase(s); }
+    static void APIENTRY DeleteProgram(GLuint p)
+    {
+        programs.erase(p);
+        if (program == p)
+            program = 0;
+    }
+
+    // binds
+    static void APIENTRY BindBuffer(GLenum target, GLuint name)
+    {
+        if (!known(buffers, name, "glBindBuffer"))
+            return;
+        if (target == GL_ELEMENT_ARRAY_BUFFER)
+            elementBuffers[vertexArray] = name;
+        else
+            boundBuffers[target] = name;
+    }
+    static void APIENTRY BindVertexArray(GLuint name)
+    {
+        if (known(vertexArrays, name, "glBindVertexArray"))
+            vertexArray = name;
+    }
+    static void APIENTRY BindTexture(GLenum, GLuint name)
+    {
+        known(textures, name, "glBindTexture");
+    }
+    static void APIENTRY ActiveTexture(GLenum unit)
+    {
+        if (unit < GL_TEXTURE0 || unit >= GL_TEXTURE0 + 32)
+            return error("glActiveTexture", "unit out of range");
+        activeUnit = unit - GL_TEXTURE0;
+    }
+    static void APIENTRY BindFramebuffer(GLenum, GLuint name)
+    {
+        known(framebuffers, name, "glBindFramebuffer");
+    }
+    static void APIENTRY BindRenderbuffer(GLenum, GLuint name)
+    {
+        known(renderbuffers, name, "glBindRenderbuffer");
+    }
+    static void APIENTRY UseProgram(GLuint name)
+    {
+        if (name != 0 && !programs.count(name))
+            return error("glUseProgram", "unknown program " + std::to_string(name));
+        program = name;
+    }
+
+    // data, buffers keep a shadow copy so mapping them hands out real memory
+    static std::vector<char>* boundBufferData(GLenum target, const char *function)
+    {
+        GLuint name = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffers[vertexArray] : boundBuffers[target];
+        if (name == 0)
+        {
+            error(function, "no buffer bound");
+            return nullptr;
+        }
+        return &bufferData[name];
+    }
+    static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum)
+    {
+        if (size < 0)
+            return error("glBufferData", "negative size");
+        if (std::vector<char> *storage = boundBufferData(target, "glBufferData"))
+        {
+            storage->assign(size, 0);
+            if (data && size)
+                std::memcpy(storage->data(), data, size);
+        }
+    }
+    static void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+    {
+        std::vector<char> *storage = boundBufferData(target, "glBufferSubData");
+        if (!storage)
+            return;
+        if (offset < 0 || size < 0 || (size_t)(offset + size) > storage->size())
+            return error("glBufferSubData", "range outside the buffer");
+        if (size)
+            std::memcpy(storage->data() + offset, data, size);
+    }
+    static void* APIENTRY MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield)
+    {
+        std::vector<char> *storage = boundBufferData(target, "glMapBufferRange");
+        if (!storage)
+            return nullptr;
+        if (offset < 0 || length < 0 || (size_t)(offset + length) > storage->size())
+        {
+            error("glMapBufferRange", "range outside the buffer");
+            return nullptr;
+        }
+        return storage->data() + offset;
+    }
+    static GLboolean APIENTRY UnmapBuffer(GLenum)
+    {
+        return GL_TRUE;
+    }
+    static void APIENTRY TexImage2D(GLenum, GLint level, GLint, GLsizei width, GLsizei height, GLint border, GLenum, GLenum, const void*)
+    {
+        if (level < 0 || width < 0 || height < 0 || border != 0)
+            error("glTexImage2D", "invalid level, size or border");
+    }
+
+    // shaders always compile and link
+    static void APIENTRY GetShaderiv(GLuint, GLenum pname, GLint *value)
+    {
+        *value = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+    static void APIENTRY GetProgramiv(GLuint, GLenum pname, GLint *value)
+    {
+        *value = (pname == GL_LINK_STATUS || pname == GL_VALIDATE_STATUS) ? GL_TRUE : 0;
+    }
+    static void APIENTRY GetInfoLog(GLuint, GLsizei size, GLsizei *length, GLchar *log)
+    {
+        if (length)
+            *length = 0;
+        if (log && size > 0)
+            log[0] = '\0';
+    }
+    // every distinct name gets the next location of its program
+    static GLint APIENTRY GetUniformLocation(GLuint name, const GLchar *uniform)
+    {
+        auto it = programs.find(name);
+        if (it == programs.end())
+        {
+            error("glGetUniformLocation", "unknown program " + std::to_string(name));
+            return -1;
+        }
+        auto inserted = it->second.locations.emplace(uniform, (GLint)it->second.locations.size());
+        return inserted.first->second;
+    }
+    static void APIENTRY Uniform1i(GLint l, GLint) { validUniform(l, "glUniform1i"); }
+    static void APIENTRY Uniform1f(GLint l, GLfloat) { validUniform(l, "glUniform1f"); }
+    static void APIENTRY Uniform2f(GLint l, GLfloat, GLfloat) { validUniform(l, "glUniform2f"); }
+    static void APIENTRY Uniform3f(GLint l, GLfloat, GLfloat, GLfloat) { validUniform(l, "glUniform3f"); }
+    static void APIENTRY Uniform4f(GLint l, GLfloat, GLfloat, GLfloat, GLfloat) { validUniform(l, "glUniform4f"); }
+    static void APIENTRY UniformFv(GLint l, GLsizei n, const GLfloat *v)
+    {
+        if (validUniform(l, "glUniform*fv") && (n < 0 || !v))
+            error("glUniform*fv", "invalid count or data");
+    }
+    static void APIENTRY UniformMatrixFv(GLint l, GLsizei n, GLboolean, const GLfloat *v)
+    {
+        if (validUniform(l, "glUniformMatrix*fv") && (n < 0 || !v))
+            error("glUniformMatrix*fv", "invalid count or data");
+    }
+
+    // draws
+    static void APIENTRY DrawArrays(GLenum, GLint first, GLsizei count)
+    {
+        if (validDraw("glDrawArrays", count) && first < 0)
+            error("glDrawArrays", "negative first");
+    }
+    static void APIENTRY DrawElements(GLenum, GLsizei count, GLenum, const void*)
+    {
+        if (validDraw("glDrawElements", count) && elementBuffers[vertexArray] == 0)
+            error("glDrawElements", "no element buffer in the vertex array");
+    }
+    static void APIENTRY DrawArraysInstanced(GLenum, GLint, GLsizei count, GLsizei)
+    {
+        validDraw("glDrawArraysInstanced", count);
+    }
+    static void APIENTRY DrawElementsInstanced(GLenum, GLsizei count, GLenum, const void*, GLsizei)
+    {
+        if (validDraw("glDrawElementsInstanced", count) && elementBuffers[vertexArray] == 0)
+            error("glDrawElementsInstanced", "no element buffer in the vertex array");
+    }
+};
+#endif
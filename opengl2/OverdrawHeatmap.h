@@ -0,0 +1,286 @@
+#ifndef OVERDRAW_HEATMAP_H
+#define OVERDRAW_HEATMAP_H
+
+#include <glad/glad.h>
+
+#include "MemoryTracker.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+enum HeatmapMode {
+    HEATMAP_OFF,
+    HEATMAP_FRAGMENTS,  // fragments shaded per pixel, i.e. overdraw
+    HEATMAP_LIGHTS,     // lights evaluated per pixel, summed over its fragments
+    HEATMAP_MODE_COUNT
+};
+
+// Debug view of where fragment shading goes, cycled with O: off, overdraw, lights evaluated.
+//
+// The lit shaders write a second output, FragCost = (1, lights evaluated), which normally goes
+// nowhere. While the heatmap is on, begin() redirects the scene into an RG16F target bound as
+// that output and blends it additively, so each pixel ends up holding the number of fragments
+// shaded there and the lights they evaluated. Depth testing stays as the scene has it, so the
+// counts are what was really shaded, e.g. about 1 per pixel with the depth pre-pass. end() draws
+// the selected channel as a heat ramp over the screen and averages both channels over the screen
+// by mipmapping the target down to one texel. That texel is read into a pixel pack buffer behind a
+// fence and picked up a frame or two later, once the GPU got there, so the view never stalls the
+// CPU on the GPU and its own timing stays meaningful.
+class OverdrawHeatmap
+{
+public:
+    // the value drawn red, anything above is clamped
+    float maxFragments = 8.0f;
+    float maxLights = 64.0f;
+
+    // call with the context current
+    void init()
+    {
+        MEMORY_TAG("heatmap", "");
+        shader.reset(new Shader("heatmap_v", "heatmap_f"));
+        shader->use();
+        shader->setInt("cost", 0);
+        // the full screen triangle is generated from gl_VertexID, core profile still wants a VAO
+        glGenVertexArrays(1, &VAO);
+    }
+
+    int mode() const
+    {
+        return currentMode;
+    }
+
+    bool isEnabled() const
+    {
+        return currentMode != HEATMAP_OFF;
+    }
+
+    // next mode, printing the averages over the frames the view was on
+    void cycle()
+    {
+        report();
+        // readbacks still in flight belong to the mode being left
+        for (Readback &readback : readbacks)
+            discard(readback);
+        currentMode = (currentMode + 1) % HEATMAP_MODE_COUNT;
+        const char* names[] = { "off", "fragments shaded per pixel", "lights evaluated per pixel" };
+        std::cout << "heatmap: " << names[currentMode] << std::endl;
+    }
+
+    void report()
+    {
+        if (frames > 0)
+            std::cout << "heatmap: " << totalFragments / frames << " fragments shaded per pixel, "
+                      << (totalFragments > 0.0 ? totalLights / totalFragments : 0.0) << " lights per fragment over "
+                      << frames << " frames" << std::endl;
+        totalFragments = totalLights = 0.0;
+        frames = 0;
+    }
+
+    // redirects the scene into the cost target, call after the frame's clear and before any draw
+    void begin(int width, int height)
+    {
+        if (!isEnabled() || !shader || width <= 0 || height <= 0)
+            return;
+        if (width != targetWidth || height != targetHeight)
+            createTarget(width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        GLenum buffers[] = { GL_NONE, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, buffers);
+        const GLfloat zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 1, zero);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+    }
+
+    // averages the counts and draws the heatmap into the default framebuffer
+    void end()
+    {
+        if (!isEnabled() || !fbo)
+            return;
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the top mip level is the mean over the screen. Non power of two sizes make each level a
+        // box filter that skips the odd row and column, close enough for a debug number.
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, costTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        collect();
+        queueReadback();
+
+        glDisable(GL_DEPTH_TEST);
+        shader->use();
+        shader->setInt("channel", currentMode == HEATMAP_LIGHTS ? 1 : 0);
+        shader->setFloat("maxValue", currentMode == HEATMAP_LIGHTS ? maxLights : maxFragments);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    // fragments shaded per pixel of the last frame read back, averaged over the whole screen
+    float fragmentsPerPixel() const
+    {
+        return fragments;
+    }
+
+    // lights evaluated per shaded fragment of the last frame
+    float lightsPerFragment() const
+    {
+        return fragments > 0.0f ? lights / fragments : 0.0f;
+    }
+
+    // call while the context is still current
+    void release()
+    {
+        for (Readback &readback : readbacks)
+        {
+            discard(readback);
+            if (readback.buffer)
+                glDeleteBuffers(1, &readback.buffer);
+            readback.buffer = 0;
+        }
+        releaseTarget();
+        if (VAO)
+            glDeleteVertexArrays(1, &VAO);
+        VAO = 0;
+        if (shader)
+            shader->release();
+        shader.reset();
+    }
+
+private:
+    // the top mip level of one frame on its way back: two floats in a pack buffer, readable once
+    // the fence behind the copy has signaled
+    struct Readback
+    {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+    };
+
+    int currentMode = HEATMAP_OFF;
+    // a frame gets skipped rather than waited for when the GPU is this many readbacks behind
+    std::array<Readback, 3> readbacks{};
+    uint64_t readbackFrame = 0;
+    std::unique_ptr<Shader> shader;
+    GLuint VAO = 0;
+    GLuint fbo = 0;
+    GLuint costTexture = 0;
+    GLuint depthRenderbuffer = 0;
+    int targetWidth = 0, targetHeight = 0;
+    int topLevel = 0;
+    float fragments = 0.0f;
+    float lights = 0.0f;
+    double totalFragments = 0.0, totalLights = 0.0;
+    int frames = 0;
+
+    // copies the top mip level into a free pack buffer, skipping the frame if none is free
+    void queueReadback()
+    {
+        auto free = std::find_if(readbacks.begin(), readbacks.end(), [](const Readback &readback) { return !readback.fence; });
+        if (free == readbacks.end())
+            return;
+        if (!free->buffer)
+        {
+            MEMORY_TAG("heatmap", "readback");
+            glGenBuffers(1, &free->buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, free->buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, 2 * sizeof(GLfloat), NULL, GL_STREAM_READ);
+        }
+        else
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, free->buffer);
+        glGetTexImage(GL_TEXTURE_2D, topLevel, GL_RG, GL_FLOAT, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        free->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        free->frame = readbackFrame++;
+    }
+
+    // takes in every readback the GPU has finished, oldest first, without waiting on any
+    void collect()
+    {
+        for (;;)
+        {
+            Readback *oldest = nullptr;
+            for (Readback &readback : readbacks)
+                if (readback.fence && (!oldest || readback.frame < oldest->frame))
+                    oldest = &readback;
+            if (!oldest)
+                return;
+            GLenum status = glClientWaitSync(oldest->fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+                return;
+            if (status != GL_WAIT_FAILED)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, oldest->buffer);
+                const GLfloat *mean = (const GLfloat*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 2 * sizeof(GLfloat), GL_MAP_READ_BIT);
+                if (mean)
+                {
+                    fragments = mean[0];
+                    lights = mean[1];
+                    totalFragments += fragments;
+                    totalLights += lights;
+                    frames++;
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                }
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            }
+            discard(*oldest);
+        }
+    }
+
+    static void discard(Readback &readback)
+    {
+        if (readback.fence)
+            glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+    }
+
+    void createTarget(int width, int height)
+    {
+        MEMORY_TAG("heatmap", "cost target");
+        releaseTarget();
+        targetWidth = width;
+        targetHeight = height;
+        topLevel = (int)std::floor(std::log2((float)std::max(width, height)));
+
+        // half floats count exactly up to 2048, far past any overdraw worth looking at
+        glGenTextures(1, &costTexture);
+        glBindTexture(GL_TEXTURE_2D, costTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, costTexture, 0);
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        GLenum buffers[] = { GL_NONE, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, buffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::HEATMAP::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void releaseTarget()
+    {
+        if (fbo)
+            glDeleteFramebuffers(1, &fbo);
+        if (costTexture)
+            glDeleteTextures(1, &costTexture);
+        if (depthRenderbuffer)
+            glDeleteRenderbuffers(1, &depthRenderbuffer);
+        fbo = costTexture = depthRenderbuffer = 0;
+        targetWidth = targetHeight = 0;
+    }
+};
+#endif
@@ -0,0 +1,353 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped CPU and GPU profiler that exports Chrome/Perfetto trace JSON (load it in chrome://tracing
+// or ui.perfetto.dev).
+//
+// CPU scopes append to a buffer owned by the recording thread, so recording never takes a lock; the
+// buffers are only read when the trace is written. When the profiler is disabled a scope costs one
+// relaxed atomic load. GPU scopes use GL_TIME_ELAPSED queries from a fixed ring and are collected
+// once their results are available, so reading them never stalls the pipeline. Collected GPU spans
+// go to a fixed ring of recent spans and a per-name latest duration; the full history is only kept
+// with keepGpuHistory(), for a trace covering the whole run.
+
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t start;     // ns since the profiler epoch
+    uint64_t duration;  // ns
+    char detail[40];
+};
+
+class Profiler
+{
+public:
+    static Profiler& get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool on)
+    {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    // keeps every collected GPU span for writeChromeTrace() instead of only the most recent ones
+    void keepGpuHistory(bool keep)
+    {
+        gpuHistoryKept = keep;
+    }
+
+    uint64_t now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // appends a finished CPU span to the calling thread's buffer
+    void record(const char* name, uint64_t start, uint64_t end, const char* detail = nullptr)
+    {
+        ThreadBuffer &buffer = threadBuffer();
+        size_t index = buffer.count.load(std::memory_order_relaxed);
+        ProfileEvent &event = buffer.events[index % ThreadBuffer::CAPACITY];
+        event.name = name;
+        event.start = start;
+        event.duration = end - start;
+        event.detail[0] = '\0';
+        if (detail)
+        {
+            std::strncpy(event.detail, detail, sizeof(event.detail) - 1);
+            event.detail[sizeof(event.detail) - 1] = '\0';
+        }
+        // publish the event to the writer of the trace
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    // GPU spans. begin returns the ring slot, or -1 when the span is skipped because another GPU
+    // span is open (GL_TIME_ELAPSED queries can't nest) or the ring is full of unread queries.
+    int beginGpu(const char* name)
+    {
+        if (gpuOpen)
+            return -1;
+        GpuQuery &query = gpuQueries[gpuNext];
+        if (query.pending)
+            return -1;
+        if (query.id == 0)
+            glGenQueries(1, &query.id);
+        query.name = name;
+        query.submitted = now();
+        query.pending = true;
+        glBeginQuery(GL_TIME_ELAPSED, query.id);
+        gpuOpen = true;
+        int slot = (int)gpuNext;
+        gpuNext = (gpuNext + 1) % gpuQueries.size();
+        return slot;
+    }
+
+    void endGpu(int slot)
+    {
+        if (slot < 0)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuOpen = false;
+    }
+
+    // collects finished GPU queries, call once per frame on the GL thread
+    void endFrame()
+    {
+        if (!isEnabled())
+            return;
+        for (size_t i = 0; i < gpuQueries.size(); i++)
+        {
+            // oldest first, so spans land on the GPU track in submission order
+            GpuQuery &query = gpuQueries[(gpuNext + i) % gpuQueries.size()];
+            if (!query.pending)
+                continue;
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &elapsed);
+            query.pending = false;
+            // the GPU runs its spans back to back, never earlier than they were submitted
+            uint64_t start = std::max(query.submitted, gpuCursor);
+            gpuCursor = start + elapsed;
+            ProfileEvent event;
+            event.name = query.name;
+            event.start = start;
+            event.duration = elapsed;
+            event.detail[0] = '\0';
+            gpuRecent[gpuRecentCount++ % gpuRecent.size()] = event;
+            if (gpuHistoryKept)
+                gpuEvents.push_back(event);
+            GpuLatest &latest = gpuLatest[query.name];
+            latest.start = start;
+            latest.duration = elapsed;
+        }
+    }
+
+    // the most recent duration recorded under name on the GPU track, in ms (0 if none yet). With
+    // maxAgeMs, spans that started longer ago than that count as none, e.g. a pass switched off.
+    double lastGpuMs(const char* name, double maxAgeMs = -1.0) const
+    {
+        auto found = gpuLatest.find(name);
+        if (found == gpuLatest.end())
+            return 0.0;
+        if (maxAgeMs >= 0.0 && now() > found->second.start + (uint64_t)(maxAgeMs * 1.0e6))
+            return 0.0;
+        return found->second.duration / 1.0e6;
+    }
+
+    bool writeChromeTrace(const std::string &path)
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::PROFILER::CANNOT_WRITE_TRACE: " << path << std::endl;
+            return false;
+        }
+        // timestamps are in microseconds, keep full ns resolution however long the run was
+        out << std::fixed << std::setprecision(3);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto writeEvent = [&](const ProfileEvent &event, uint32_t tid, const char* category)
+        {
+            out << (first ? "" : ",\n");
+            first = false;
+            out << "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+            if (event.detail[0])
+                out << ",\"args\":{\"detail\":\"" << escape(event.detail) << "\"}";
+            out << "}";
+        };
+
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+        {
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            size_t begin = count > ThreadBuffer::CAPACITY ? count - ThreadBuffer::CAPACITY : 0;
+            for (size_t i = begin; i < count; i++)
+                writeEvent(buffer->events[i % ThreadBuffer::CAPACITY], buffer->tid, "cpu");
+            out << (first ? "" : ",\n");
+            first = false;
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"" << (buffer->tid == 1 ? "main" : "worker " + std::to_string(buffer->tid)) << "\"}}";
+        }
+        if (gpuHistoryKept)
+            for (const ProfileEvent &event : gpuEvents)
+                writeEvent(event, GPU_TID, "gpu");
+        else
+            for (size_t i = gpuRecentCount > gpuRecent.size() ? gpuRecentCount - gpuRecent.size() : 0; i < gpuRecentCount; i++)
+                writeEvent(gpuRecent[i % gpuRecent.size()], GPU_TID, "gpu");
+        out << (first ? "" : ",\n");
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TID << ",\"args\":{\"name\":\"GPU\"}}";
+        out << "\n]}\n";
+        std::cout << "profiler: wrote " << path << std::endl;
+        return true;
+    }
+
+    // deletes the query objects, call while the context is still current
+    void release()
+    {
+        for (GpuQuery &query : gpuQueries)
+            if (query.id)
+                glDeleteQueries(1, &query.id);
+        gpuQueries = {};
+    }
+
+private:
+    static constexpr uint32_t GPU_TID = 1000;
+
+    struct ThreadBuffer
+    {
+        // oldest events are overwritten once a thread records more than this
+        static constexpr size_t CAPACITY = 1 << 15;
+        std::vector<ProfileEvent> events = std::vector<ProfileEvent>(CAPACITY);
+        std::atomic<size_t> count{0};
+        uint32_t tid = 0;
+    };
+
+    struct GpuLatest
+    {
+        uint64_t start = 0;
+        uint64_t duration = 0;
+    };
+
+    struct GpuQuery
+    {
+        GLuint id = 0;
+        const char* name = nullptr;
+        uint64_t submitted = 0;
+        bool pending = false;
+    };
+
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    std::array<GpuQuery, 64> gpuQueries{};
+    size_t gpuNext = 0;
+    bool gpuOpen = false;
+    uint64_t gpuCursor = 0;
+    std::array<ProfileEvent, 1024> gpuRecent{};
+    size_t gpuRecentCount = 0;
+    // keyed by name, looked up with the span's const char* without allocating
+    std::map<std::string, GpuLatest, std::less<>> gpuLatest;
+    bool gpuHistoryKept = false;
+    std::vector<ProfileEvent> gpuEvents;
+
+    // registered once per thread under the mutex, lock-free afterwards. Buffers outlive their
+    // threads so events from finished workers still end up in the trace.
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->tid = (uint32_t)buffers.size();
+        }
+        return *buffer;
+    }
+
+    static std::string escape(const char* text)
+    {
+        std::string escaped;
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                escaped += '\\';
+            if ((unsigned char)*c < 0x20)
+                continue;
+            escaped += *c;
+        }
+        return escaped;
+    }
+};
+
+// RAII CPU span, recorded when it goes out of scope
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name, const char* detail = nullptr)
+    {
+        if (!Profiler::get().isEnabled())
+            return;
+        this->name = name;
+        this->detail = detail;
+        start = Profiler::get().now();
+    }
+
+    ~ProfileScope()
+    {
+        if (name)
+            Profiler::get().record(name, start, Profiler::get().now(), detail);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name = nullptr;
+    const char* detail = nullptr;
+    uint64_t start = 0;
+};
+
+// RAII GPU span, measured with a GL_TIME_ELAPSED query. Must not be nested.
+class GpuProfileScope
+{
+public:
+    explicit GpuProfileScope(const char* name)
+    {
+        if (Profiler::get().isEnabled())
+            slot = Profiler::get().beginGpu(name);
+    }
+
+    ~GpuProfileScope()
+    {
+        Profiler::get().endGpu(slot);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    int slot = -1;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// CPU span named name for the rest of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// same with a per-call detail string (e.g. an asset path), shown under args in the trace
+#define PROFILE_SCOPE_DETAIL(name, detail) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, detail)
+// CPU span plus a GPU span of the commands issued in the block
+#define PROFILE_GPU_SCOPE(name) PROFILE_SCOPE(name); GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#endif
@@ -0,0 +1,257 @@
+#ifndef SCENE_GEN_H
+#define SCENE_GEN_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// size of the pointLights[] array in cube_f_shader and backpack_f
+const int MAX_POINT_LIGHTS = 32;
+
+struct PointLight
+{
+    glm::vec3 position;
+    float constant;
+    float linear;
+    float quadratic;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+// what the world is filled with
+struct Scene
+{
+    std::vector<glm::vec3> cubes;
+    std::vector<PointLight> lights;
+    // backpack instances
+    std::vector<glm::mat4> models;
+};
+
+// Stress-scene parameters, from the command line (--cubes/--lights/--models/--seed) or a
+// "key = value" config file (--scene file). Anything left at -1 keeps the hand-made scene's value.
+struct SceneParams
+{
+    int cubes = -1;
+    int lights = -1;
+    int models = -1;
+    uint32_t seed = 1;
+
+    bool generated() const
+    {
+        return cubes >= 0 || lights >= 0 || models >= 0;
+    }
+
+    bool loadConfig(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SCENE::CONFIG_NOT_FOUND " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            size_t equals = line.find('=');
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            std::string key;
+            long value = 0;
+            std::istringstream keyStream(line.substr(0, equals));
+            std::istringstream valueStream(equals == std::string::npos ? "" : line.substr(equals + 1));
+            if (equals == std::string::npos || !(keyStream >> key) || !(valueStream >> value) || !set(key, value))
+            {
+                std::cout << "ERROR::SCENE::CONFIG_SYNTAX " << path << ":" << lineNumber << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool set(const std::string &key, long value)
+    {
+        if (key == "cubes")
+            cubes = (int)std::max(0L, value);
+        else if (key == "lights")
+            lights = (int)std::max(0L, value);
+        else if (key == "models")
+            models = (int)std::max(0L, value);
+        else if (key == "seed")
+            seed = (uint32_t)value;
+        else
+            return false;
+        return true;
+    }
+};
+
+// Lays out cubes, point lights and backpack instances procedurally around the benchmark's orbit
+// center. The same seed gives the same scene on every platform: the generator is a plain xorshift
+// and never goes through <random>'s distributions, whose output differs between standard libraries.
+class SceneGen
+{
+public:
+    // the scene main.cpp always had: 13 cubes, 4 point lights and one backpack. Cubes past the
+    // first 13 go on a grid behind it (--objects).
+    static Scene handMade(int cubeCount)
+    {
+        Scene scene;
+        scene.cubes = {
+            glm::vec3(  2.0f,  -0.5f,  0.0f),
+            glm::vec3(  2.0f,  -0.5f, -1.0f),
+            glm::vec3(  2.0f,  -0.5f, -2.0f),
+            glm::vec3(  2.0f,  -0.5f, -3.0f),
+            glm::vec3(  2.0f,  -0.5f, -4.0f),
+            glm::vec3( -2.0f,  -0.5f,  0.0f),
+            glm::vec3( -2.0f,  -0.5f, -1.0f),
+            glm::vec3( -2.0f,  -0.5f, -2.0f),
+            glm::vec3( -2.0f,  -0.5f, -3.0f),
+            glm::vec3( -2.0f,  -0.5f, -4.0f),
+
+            glm::vec3(  0.0f, -0.5f, -4.0f),
+            glm::vec3(  1.0f, -0.5f, -4.0f),
+            glm::vec3( -1.0f, -0.5f, -4.0f),
+        };
+        for (int i = (int)scene.cubes.size(); i < cubeCount; ++i)
+        {
+            int k = i - 13;
+            scene.cubes.push_back(glm::vec3(-37.0f + (k % 50) * 1.5f, -0.5f, -6.0f - (k / 50) * 1.5f));
+        }
+        scene.cubes.resize(cubeCount);
+
+        const glm::vec3 positions[] = {
+            glm::vec3( 0.7f,  0.2f,  2.0f),
+            glm::vec3( 2.3f, -3.3f, -4.0f),
+            glm::vec3(-4.0f,  2.0f, -12.0f),
+            glm::vec3( 0.0f,  0.0f, -3.0f)
+        };
+        for (const glm::vec3 &position : positions)
+            scene.lights.push_back({ position, 1.0f, 0.09f, 0.032f, glm::vec3(0.05f), glm::vec3(0.8f), glm::vec3(1.0f) });
+
+        glm::mat4 backpack = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.5f));
+        scene.models.push_back(glm::scale(backpack, glm::vec3(0.2f)));
+        return scene;
+    }
+
+    // unset parameters keep the hand-made scene's counts
+    static Scene generate(const SceneParams &params)
+    {
+        Random random(params.seed);
+        int cubeCount = params.cubes >= 0 ? params.cubes : 13;
+        int lightCount = std::min(params.lights >= 0 ? params.lights : 4, MAX_POINT_LIGHTS);
+        int modelCount = params.models >= 0 ? params.models : 1;
+        if (params.lights > MAX_POINT_LIGHTS)
+            std::cout << "SCENE: clamping " << params.lights << " point lights to " << MAX_POINT_LIGHTS << std::endl;
+
+        Scene scene;
+        // cubes and models share one jittered grid so they never overlap; models take 2x2 cells
+        int cells = cubeCount + modelCount * 4;
+        int side = std::max(1, (int)std::ceil(std::sqrt((float)cells)));
+        const float spacing = 1.6f;
+        const glm::vec3 center(0.0f, -0.5f, -2.0f);
+        glm::vec3 origin = center - glm::vec3((side - 1) * spacing * 0.5f, 0.0f, (side - 1) * spacing * 0.5f);
+
+        std::vector<int> order(side * side);
+        for (int i = 0; i < (int)order.size(); i++)
+            order[i] = i;
+        for (int i = (int)order.size() - 1; i > 0; i--)
+            std::swap(order[i], order[random.below(i + 1)]);
+
+        std::vector<bool> taken(order.size(), false);
+        size_t next = 0;
+        for (int i = 0; i < modelCount; i++)
+        {
+            // first free cell whose right and lower neighbours are free too, else any free cell
+            int cell = -1;
+            for (size_t j = next; j < order.size() && cell < 0; j++)
+            {
+                int c = order[j];
+                int x = c % side, z = c / side;
+                if (!taken[c] && x + 1 < side && z + 1 < side && !taken[c + 1] && !taken[c + side] && !taken[c + side + 1])
+                    cell = c;
+            }
+            float offset = 0.5f;
+            if (cell >= 0)
+                taken[cell] = taken[cell + 1] = taken[cell + side] = taken[cell + side + 1] = true;
+            else
+            {
+                cell = takeFree(order, taken, next);
+                offset = 0.0f;
+            }
+            int x = cell % side, z = cell / side;
+
+            glm::vec3 position = origin + glm::vec3((x + offset) * spacing, 0.5f, (z + offset) * spacing);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            model = glm::rotate(model, random.range(0.0f, 6.2831853f), glm::vec3(0.0f, 1.0f, 0.0f));
+            scene.models.push_back(glm::scale(model, glm::vec3(0.2f)));
+        }
+        for (int i = 0; i < cubeCount; i++)
+        {
+            int cell = takeFree(order, taken, next);
+            glm::vec3 jitter(random.range(-0.25f, 0.25f), 0.0f, random.range(-0.25f, 0.25f));
+            scene.cubes.push_back(origin + glm::vec3((cell % side) * spacing, 0.0f, (cell / side) * spacing) + jitter);
+        }
+
+        float extent = std::max(side * spacing * 0.5f, 4.0f);
+        for (int i = 0; i < lightCount; i++)
+        {
+            PointLight light;
+            light.position = center + glm::vec3(random.range(-extent, extent), random.range(0.5f, 3.0f), random.range(-extent, extent));
+            // attenuation for a random reach between 7 and 50 units, the usual constant/linear/quadratic fit
+            float reach = random.range(7.0f, 50.0f);
+            light.constant = 1.0f;
+            light.linear = 4.5f / reach;
+            light.quadratic = 75.0f / (reach * reach);
+            light.diffuse = glm::vec3(random.range(0.4f, 1.0f), random.range(0.4f, 1.0f), random.range(0.4f, 1.0f));
+            light.ambient = light.diffuse * 0.0625f;
+            light.specular = glm::vec3(1.0f);
+            scene.lights.push_back(light);
+        }
+        return scene;
+    }
+
+private:
+    struct Random
+    {
+        uint32_t state;
+        explicit Random(uint32_t seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+        uint32_t next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+        // uniform in [lo, hi)
+        float range(float lo, float hi)
+        {
+            return lo + (hi - lo) * (float)(next() >> 8) * (1.0f / 16777216.0f);
+        }
+        // uniform in [0, n)
+        int below(int n)
+        {
+            return (int)(((uint64_t)next() * (uint32_t)n) >> 32);
+        }
+    };
+
+    static int takeFree(const std::vector<int> &order, std::vector<bool> &taken, size_t &next)
+    {
+        while (taken[order[next]])
+            next++;
+        taken[order[next]] = true;
+        return order[next];
+    }
+};
+#endif
@@ -11,142 +11,513 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "GLExtensions.h"
+#include "ShaderCache.h"
+#include "Profiler.h"
+#include "HitchDetector.h"
+#include "MemoryTracker.h"
+#include "LoadReport.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <map>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include <string>
+#include <unordered_map>
+#include <vector>
 
 class Shader
 {
 public:
+    // the linked program. When the shader runs as a program pipeline this is its fragment-stage
+    // program, the vertex stage may be shared with other shaders.
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly. With deferred set, compile and link are only
+    // issued and finish() has to be called before first use, which lets the driver build several
+    // programs in parallel while the caller does other work.
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, bool deferred = false)
     {
+        PROFILE_SCOPE_DETAIL("Shader::Shader", fragmentPath);
+        HITCH_SCOPE("shader build", fragmentPath);
+        MEMORY_TAG("shader", fragmentPath);
+        LOAD_PHASE(LOAD_SHADER_COMPILE, fragmentPath);
+        name = fragmentPath;
         // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile(vertexPath);
-        std::ifstream fShaderFile(fragmentPath);
-        std::ofstream os;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try
+        std::string vertexCode = readSource(vertexPath);
+        std::string fragmentCode = readSource(fragmentPath);
+        LoadReport::addBytesRead(name, vertexCode.size() + fragmentCode.size());
+
+        // with separate shader objects every stage is its own program, shared by source
+        if (separablePrograms())
         {
-            // open files
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            vertexStage = Stage::get(GL_VERTEX_SHADER, vertexCode);
+            fragmentStage = Stage::get(GL_FRAGMENT_SHADER, fragmentCode);
+            ID = fragmentStage->program;
+            glExt.GenProgramPipelines(1, &pipeline);
+            glExt.UseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertexStage->program);
+            glExt.UseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragmentStage->program);
+            if (!deferred)
+                finish();
+            return;
         }
-        catch (std::ifstream::failure& e)
+
+        // 2. try the program binary cache first
+        ID = glCreateProgram();
+        cacheKey = ShaderCache::keyFor({vertexCode, fragmentCode});
+        if (ShaderCache::load(ID, cacheKey))
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+            locations.build(ID);
+            return;
         }
+
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        // 3. compile shaders
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if (ShaderCache::enabled())
+            glExt.ProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        pending = true;
+
+        if (!deferred)
+            finish();
+    }
+    // build shaders as program pipelines whenever the driver supports GL_ARB_separate_shader_objects.
+    // Only affects shaders constructed afterwards.
+    // ------------------------------------------------------------------------
+    static bool& useSeparablePrograms()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+    // waits for a deferred build, reports errors and stores the binary in the cache
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        PROFILE_SCOPE("Shader::finish");
+        // waiting for a deferred build is part of compiling it
+        LOAD_PHASE(LOAD_SHADER_COMPILE, name.c_str());
+        if (pipeline)
+        {
+            vertexStage->finish();
+            fragmentStage->finish();
+            return;
+        }
+        if (!pending)
+            return;
+        pending = false;
+        bool ok = checkCompileErrors(vertex, "VERTEX");
+        ok = checkCompileErrors(fragment, "FRAGMENT") && ok;
+        ok = checkCompileErrors(ID, "PROGRAM") && ok;
         // delete the shaders as they're linked into our program now and no longer necessery
+        glDetachShader(ID, vertex);
+        glDetachShader(ID, fragment);
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        locations.build(ID);
+        if (ok)
+            ShaderCache::store(ID, cacheKey);
+    }
+    // draws once with the given vertex array into a 1x1 scissor so the driver finishes any
+    // draw-time compilation now instead of on the first real frame
+    // ------------------------------------------------------------------------
+    void warmUp(unsigned int VAO)
+    {
+        finish();
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, 0, 1, 1);
+        use();
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glDisable(GL_SCISSOR_TEST);
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
+        if (pipeline)
+        {
+            // a bound program always wins over the pipeline binding
+            if (boundProgram())
+            {
+                glUseProgram(0);
+                boundProgram() = 0;
+            }
+            glExt.BindProgramPipeline(pipeline);
+            return;
+        }
         glUseProgram(ID);
+        boundProgram() = ID;
     }
-    // utility uniform functions
+    // utility uniform functions. Locations come from a per-program cache filled at link time.
+    // Pipelines set the value on every stage that declares it (glProgramUniform ignores
+    // location -1), so shared stages don't need to be bound.
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setInt(name, (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform1i(stage->program, stage->locations.find(stage->program, name), value);
+            return;
+        }
+        glUniform1i(locations.find(ID, name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform1f(stage->program, stage->locations.find(stage->program, name), value);
+            return;
+        }
+        glUniform1f(locations.find(ID, name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform2fv(stage->program, stage->locations.find(stage->program, name), 1, &value[0]);
+            return;
+        }
+        glUniform2fv(locations.find(ID, name), 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform2f(stage->program, stage->locations.find(stage->program, name), x, y);
+            return;
+        }
+        glUniform2f(locations.find(ID, name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform3fv(stage->program, stage->locations.find(stage->program, name), 1, &value[0]);
+            return;
+        }
+        glUniform3fv(locations.find(ID, name), 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform3f(stage->program, stage->locations.find(stage->program, name), x, y, z);
+            return;
+        }
+        glUniform3f(locations.find(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform4fv(stage->program, stage->locations.find(stage->program, name), 1, &value[0]);
+            return;
+        }
+        glUniform4fv(locations.find(ID, name), 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniform4f(stage->program, stage->locations.find(stage->program, name), x, y, z, w);
+            return;
+        }
+        glUniform4f(locations.find(ID, name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniformMatrix2fv(stage->program, stage->locations.find(stage->program, name), 1, GL_FALSE, &mat[0][0]);
+            return;
+        }
+        glUniformMatrix2fv(locations.find(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniformMatrix3fv(stage->program, stage->locations.find(stage->program, name), 1, GL_FALSE, &mat[0][0]);
+            return;
+        }
+        glUniformMatrix3fv(locations.find(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                glExt.ProgramUniformMatrix4fv(stage->program, stage->locations.find(stage->program, name), 1, GL_FALSE, &mat[0][0]);
+            return;
+        }
+        glUniformMatrix4fv(locations.find(ID, name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // points a uniform block at a binding point (GLSL 330 can't say layout(binding)), on every
+    // stage that declares it. Call after finish().
+    // ------------------------------------------------------------------------
+    void setBlockBinding(const std::string &name, unsigned int binding) const
+    {
+        if (pipeline)
+        {
+            for (Stage* stage : pipelineStages())
+                bindBlock(stage->program, name, binding);
+            return;
+        }
+        bindBlock(ID, name, binding);
+    }
+    // deletes the program, or the pipeline when the stages are shared. Call while the context is
+    // still current, then releaseStages() once every shader is released.
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        if (pipeline)
+        {
+            glExt.DeleteProgramPipelines(1, &pipeline);
+            pipeline = 0;
+            vertexStage = fragmentStage = nullptr;
+        }
+        else if (ID)
+        {
+            glDeleteProgram(ID);
+            if (boundProgram() == ID)
+                boundProgram() = 0;
+        }
+        ID = 0;
+    }
+    // deletes the stage programs pipelines share
+    // ------------------------------------------------------------------------
+    static void releaseStages()
+    {
+        for (auto &entry : Stage::all())
+            glDeleteProgram(entry.second.program);
+        Stage::all().clear();
     }
-    
+
 
 private:
+    // uniform locations of one program, read from its active uniforms once it is linked so the
+    // setters don't look names up in the driver. Names it doesn't list (block members, uniforms
+    // the compiler dropped, NullGL which reports none) are looked up on first use and remembered.
+    struct UniformLocations
+    {
+        std::unordered_map<std::string, GLint> byName;
+
+        void build(unsigned int program)
+        {
+            byName.clear();
+            GLint count = 0, maxLength = 0;
+            glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+            glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+            std::vector<GLchar> buffer(std::max(maxLength, 1));
+            for (GLint i = 0; i < count; i++)
+            {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                glGetActiveUniform(program, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+                std::string name(buffer.data(), length);
+                // arrays are listed once as name[0], setters may use name, name[0] or name[i]
+                if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+                {
+                    std::string base = name.substr(0, name.size() - 3);
+                    add(program, base);
+                    for (GLint element = 0; element < size; element++)
+                        add(program, base + "[" + std::to_string(element) + "]");
+                }
+                else
+                    add(program, name);
+            }
+        }
+
+        GLint find(unsigned int program, const std::string &name)
+        {
+            auto found = byName.find(name);
+            if (found != byName.end())
+                return found->second;
+            return add(program, name);
+        }
+
+    private:
+        GLint add(unsigned int program, const std::string &name)
+        {
+            GLint location = glGetUniformLocation(program, name.c_str());
+            byName[name] = location;
+            return location;
+        }
+    };
+
+    // one separable stage program. Stages are registered by a hash of their type and source, so
+    // every Shader using byte-identical source for a stage shares the same program object.
+    struct Stage
+    {
+        GLenum type = 0;
+        unsigned int program = 0;
+        unsigned int shader = 0;
+        std::string cacheKey;
+        bool pending = false;
+        UniformLocations locations;
+
+        static std::map<std::string, Stage>& all()
+        {
+            static std::map<std::string, Stage> stages;
+            return stages;
+        }
+
+        static Stage* get(GLenum type, const std::string &code)
+        {
+            std::map<std::string, Stage> &stages = all();
+            std::string key = ShaderCache::keyFor({type == GL_VERTEX_SHADER ? "separable vertex" : "separable fragment", code});
+            auto found = stages.find(key);
+            if (found != stages.end())
+                return &found->second;
+
+            Stage &stage = stages[key];
+            stage.type = type;
+            stage.cacheKey = key;
+            stage.program = glCreateProgram();
+            glExt.ProgramParameteri(stage.program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+            if (ShaderCache::load(stage.program, key))
+            {
+                stage.locations.build(stage.program);
+                return &stage;
+            }
+
+            const char* source = code.c_str();
+            stage.shader = glCreateShader(type);
+            glShaderSource(stage.shader, 1, &source, NULL);
+            glCompileShader(stage.shader);
+            glAttachShader(stage.program, stage.shader);
+            if (ShaderCache::enabled())
+                glExt.ProgramParameteri(stage.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(stage.program);
+            stage.pending = true;
+            return &stage;
+        }
+
+        void finish()
+        {
+            if (!pending)
+                return;
+            pending = false;
+            bool ok = checkCompileErrors(shader, type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT");
+            ok = checkCompileErrors(program, "PROGRAM") && ok;
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+            locations.build(program);
+            if (ok)
+                ShaderCache::store(program, cacheKey);
+        }
+    };
+
+    unsigned int vertex = 0, fragment = 0;
+    // fragment source path, names the shader in reports
+    std::string name;
+    std::string cacheKey;
+    bool pending = false;
+    mutable UniformLocations locations;
+    unsigned int pipeline = 0;
+    Stage* vertexStage = nullptr;
+    Stage* fragmentStage = nullptr;
+
+    static bool separablePrograms()
+    {
+        return glExt.separateShaderObjects && useSeparablePrograms();
+    }
+
+    std::array<Stage*, 2> pipelineStages() const
+    {
+        return {vertexStage, fragmentStage};
+    }
+
+    // program last made current with glUseProgram, which a pipeline has to unbind to take effect
+    static unsigned int& boundProgram()
+    {
+        static unsigned int bound = 0;
+        return bound;
+    }
+
+    static void bindBlock(unsigned int program, const std::string &name, unsigned int binding)
+    {
+        GLuint index = glGetUniformBlockIndex(program, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, binding);
+    }
+
+    static std::string readSource(const char* path)
+    {
+        std::string code;
+        std::ifstream file(resolveSource(path));
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            code = stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << " " << e.what() << std::endl;
+        }
+        return code;
+    }
+
+    // prefers the copy installed by tools/optimize_shaders.sh in optimized/ over the hand-written source,
+    // unless the source was edited after the copy was made
+    // ------------------------------------------------------------------------
+    static std::string resolveSource(const char* path)
+    {
+        std::string optimized = std::string("optimized/") + path;
+        std::error_code ec, sourceEc;
+        auto optimizedTime = std::filesystem::last_write_time(optimized, ec);
+        auto sourceTime = std::filesystem::last_write_time(path, sourceEc);
+        if (ec || (!sourceEc && sourceTime > optimizedTime))
+            return path;
+        return optimized;
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -168,6 +539,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success == GL_TRUE;
     }
 };
 #endif
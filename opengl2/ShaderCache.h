@@ -0,0 +1,150 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include "GLExtensions.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of the shader sources together with the GL vendor, renderer and
+// version strings, so a driver update or a different GPU simply misses instead of loading garbage.
+class ShaderCache
+{
+public:
+    // directory the binaries live in, relative to the working directory. Empty disables the cache.
+    static std::string& directory()
+    {
+        static std::string dir = "shader_cache";
+        return dir;
+    }
+
+    static bool enabled()
+    {
+        return glExt.programBinary && !directory().empty();
+    }
+
+    // builds the cache key for a program from all of its stage sources
+    static std::string keyFor(const std::vector<std::string> &sources)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const std::string &s)
+        {
+            for (unsigned char c : s)
+            {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            // separator so "ab"+"c" and "a"+"bc" hash differently
+            hash ^= 0xff;
+            hash *= 1099511628211ull;
+        };
+        mix(driverIdentity());
+        for (const std::string &s : sources)
+            mix(s);
+
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        return name;
+    }
+
+    // tries to restore a program from the cache; returns false on a miss or if the driver rejects the binary
+    static bool load(GLuint program, const std::string &key)
+    {
+        if (!enabled())
+            return false;
+        std::ifstream file(pathFor(key), std::ios::binary);
+        if (!file)
+            return false;
+
+        Header header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != MAGIC || header.identityLength > 4096)
+            return false;
+        std::string identity(header.identityLength, '\0');
+        file.read(&identity[0], header.identityLength);
+        if (!file || identity != driverIdentity())
+            return false;
+        std::vector<char> binary(header.length);
+        file.read(binary.data(), header.length);
+        if (!file)
+            return false;
+
+        glExt.ProgramBinary(program, header.format, binary.data(), (GLsizei)header.length);
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success == GL_TRUE;
+    }
+
+    // writes the binary of a successfully linked program to the cache
+    static void store(GLuint program, const std::string &key)
+    {
+        if (!enabled())
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glExt.GetProgramBinary(program, length, &length, &format, binary.data());
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory(), ec);
+        std::ofstream file(pathFor(key), std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "WARNING::SHADER_CACHE::CANNOT_WRITE: " << pathFor(key) << std::endl;
+            return;
+        }
+        std::string identity = driverIdentity();
+        Header header;
+        header.magic = MAGIC;
+        header.format = format;
+        header.length = (uint32_t)length;
+        header.identityLength = (uint32_t)identity.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(identity.data(), identity.size());
+        file.write(binary.data(), length);
+    }
+
+private:
+    static constexpr uint32_t MAGIC = 0x42505347; // "GSPB"
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t format;
+        uint32_t length;
+        uint32_t identityLength;
+    };
+
+    static std::string pathFor(const std::string &key)
+    {
+        return directory() + "/" + key + ".bin";
+    }
+
+    static const std::string& driverIdentity()
+    {
+        static std::string identity;
+        if (identity.empty())
+        {
+            auto str = [](GLenum name)
+            {
+                const GLubyte *s = glGetString(name);
+                return s ? std::string(reinterpret_cast<const char*>(s)) : std::string();
+            };
+            identity = str(GL_VENDOR) + "|" + str(GL_RENDERER) + "|" + str(GL_VERSION);
+        }
+        return identity;
+    }
+};
+#endif
@@ -0,0 +1,169 @@
+#ifndef SHADER_LOD_H
+#define SHADER_LOD_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Lighting levels understood by cube_f_shader and backpack_f through the lightingLod uniform
+enum LightingLod {
+    LOD_FULL = 0,       // directional + all point lights + flashlight
+    LOD_NEAREST = 1,    // directional + the nearest point light
+    LOD_BAKED = 2,      // directional + point light ambient baked on the CPU
+    LOD_COUNT
+};
+
+// Picks a lighting level from the projected size of an object's bounding sphere.
+// A level only changes once the size has moved past its threshold by the hysteresis margin,
+// so objects hovering around a threshold don't pop back and forth every frame.
+struct LodSelector
+{
+    // projected diameter in pixels above which a level is used
+    float fullAbove = 96.0f;
+    float nearestAbove = 24.0f;
+    // fraction of the threshold the size has to cross before switching
+    float hysteresis = 0.15f;
+
+    int select(int current, float pixels) const
+    {
+        int target = LOD_BAKED;
+        if (pixels >= nearestAbove)
+            target = LOD_NEAREST;
+        if (pixels >= fullAbove)
+            target = LOD_FULL;
+        // one level at a time, each against its own threshold: moving to more detail needs the size
+        // to be above it by the margin, moving to less detail needs it to be below by the margin
+        int level = current;
+        while (level > target && pixels >= thresholdFor(level - 1) * (1.0f + hysteresis))
+            level--;
+        while (level < target && pixels <= thresholdFor(level) * (1.0f - hysteresis))
+            level++;
+        return level;
+    }
+
+    // projected diameter in pixels of a sphere seen through a perspective projection
+    static float projectedDiameter(const glm::vec3 &center, float radius, const glm::mat4 &view, const glm::mat4 &projection, float viewportHeight)
+    {
+        glm::vec4 viewPos = view * glm::vec4(center, 1.0f);
+        float distance = glm::max(-viewPos.z, 0.001f);
+        // projection[1][1] is cot(fovy / 2)
+        return radius * 2.0f * projection[1][1] / distance * viewportHeight * 0.5f;
+    }
+
+private:
+    // threshold between level and level + 1
+    float thresholdFor(int level) const
+    {
+        return level == LOD_FULL ? fullAbove : nearestAbove;
+    }
+};
+
+// Counts the samples each lighting level shaded, using GL_SAMPLES_PASSED queries around every
+// run of draws at the same level. Results are read back two frames later, by which time the GPU
+// has normally finished them and the read doesn't stall.
+class LodStats
+{
+public:
+    bool enabled = true;
+
+    // switches the level the following draws are accounted to
+    void setLevel(int level)
+    {
+        if (!enabled || level == activeLevel)
+            return;
+        endQuery();
+        Frame &frame = frames[frameIndex];
+        if (frame.used == frame.queries.size())
+        {
+            frame.queries.emplace_back();
+            glGenQueries(1, &frame.queries.back().id);
+        }
+        Query &query = frame.queries[frame.used++];
+        query.level = level;
+        glBeginQuery(GL_SAMPLES_PASSED, query.id);
+        activeLevel = level;
+    }
+
+    // closes the frame's queries and collects the oldest frame's results
+    void endFrame()
+    {
+        if (!enabled)
+            return;
+        endQuery();
+        frameIndex = (frameIndex + 1) % frames.size();
+        Frame &oldest = frames[frameIndex];
+        if (oldest.used > 0)
+            lastFrame.fill(0);
+        for (unsigned int i = 0; i < oldest.used; i++)
+        {
+            GLuint samples = 0;
+            glGetQueryObjectuiv(oldest.queries[i].id, GL_QUERY_RESULT, &samples);
+            totals[oldest.queries[i].level] += samples;
+            lastFrame[oldest.queries[i].level] += samples;
+        }
+        if (oldest.used > 0)
+            frameCount++;
+        oldest.used = 0;
+    }
+
+    // samples shaded per level in the most recently collected frame
+    const std::array<uint64_t, LOD_COUNT>& collected() const
+    {
+        return lastFrame;
+    }
+
+    void report(std::ostream &out) const
+    {
+        static const char* names[LOD_COUNT] = { "full", "nearest", "baked" };
+        out << "lighting LOD samples shaded over " << frameCount << " frames:" << std::endl;
+        for (int level = 0; level < LOD_COUNT; level++)
+        {
+            out << "  " << names[level] << ": " << totals[level];
+            if (frameCount > 0)
+                out << " (" << totals[level] / frameCount << " per frame)";
+            out << std::endl;
+        }
+    }
+
+    // deletes the query objects, call while the context is still current
+    void release()
+    {
+        for (Frame &frame : frames)
+            for (Query &query : frame.queries)
+                glDeleteQueries(1, &query.id);
+    }
+
+private:
+    struct Query
+    {
+        GLuint id = 0;
+        int level = 0;
+    };
+    struct Frame
+    {
+        std::vector<Query> queries;
+        unsigned int used = 0;
+    };
+
+    // three frames in flight before a result is read back
+    std::array<Frame, 3> frames;
+    size_t frameIndex = 0;
+    int activeLevel = -1;
+    std::array<uint64_t, LOD_COUNT> totals{};
+    std::array<uint64_t, LOD_COUNT> lastFrame{};
+    uint64_t frameCount = 0;
+
+    void endQuery()
+    {
+        if (activeLevel < 0)
+            return;
+        glEndQuery(GL_SAMPLES_PASSED);
+        activeLevel = -1;
+    }
+};
+#endif
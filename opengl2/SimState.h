@@ -0,0 +1,102 @@
+#ifndef SIM_STATE_H
+#define SIM_STATE_H
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Lock-free single producer, single consumer exchange of the latest value. The writer fills
+// back() and publishes it, the reader picks up the newest published value with update(). Three
+// buffers mean neither side ever waits: the writer always has one to fill, the reader always
+// has the one it's reading, and the third holds the newest value not yet picked up. Values the
+// reader doesn't get to in time are overwritten.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // writer only
+    T& back()
+    {
+        return buffers[backIndex];
+    }
+
+    // writer only: makes back() the newest value and hands the writer another buffer
+    void publish()
+    {
+        backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader only: switches front() to the newest value, false if nothing was published since
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // reader only
+    const T& front() const
+    {
+        return buffers[frontIndex];
+    }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T buffers[3];
+    int backIndex = 0;
+    // index of the buffer between writer and reader, FRESH if the reader hasn't taken it yet
+    std::atomic<int> middle{1};
+    int frontIndex = 2;
+};
+
+// What one simulation tick hands to the renderer. The scene has no animated objects or lights
+// yet, so that is the camera and the flashlight; anything the simulation comes to move goes here.
+struct SimSnapshot
+{
+    // simulated time at the end of the tick, on the glfwGetTime() clock
+    double time = 0.0;
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = YAW;
+    float pitch = PITCH;
+    float zoom = ZOOM;
+    bool flashlight = false;
+
+    static SimSnapshot capture(double time, const Camera &camera, bool flashlight)
+    {
+        SimSnapshot snapshot;
+        snapshot.time = time;
+        snapshot.position = camera.Position;
+        snapshot.yaw = camera.Yaw;
+        snapshot.pitch = camera.Pitch;
+        snapshot.zoom = camera.Zoom;
+        snapshot.flashlight = flashlight;
+        return snapshot;
+    }
+
+    // the state at `time` between two ticks, clamped to them. Toggles switch at b.
+    static SimSnapshot interpolate(const SimSnapshot &a, const SimSnapshot &b, double time)
+    {
+        float t = b.time > a.time ? (float)std::clamp((time - a.time) / (b.time - a.time), 0.0, 1.0) : 1.0f;
+        SimSnapshot snapshot;
+        snapshot.time = time;
+        snapshot.position = glm::mix(a.position, b.position, t);
+        snapshot.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        snapshot.pitch = a.pitch + (b.pitch - a.pitch) * t;
+        snapshot.zoom = a.zoom + (b.zoom - a.zoom) * t;
+        snapshot.flashlight = b.flashlight;
+        return snapshot;
+    }
+
+    void apply(Camera &camera) const
+    {
+        camera.SetPose(position, yaw, pitch);
+        camera.Zoom = zoom;
+    }
+};
+#endif
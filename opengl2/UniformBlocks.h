@@ -0,0 +1,163 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <glm/glm.hpp>
+
+#include "FrameRing.h"
+#include "SceneGen.h"
+
+#include <algorithm>
+#include <vector>
+
+// CPU copies of the std140 uniform blocks the scene shaders declare, laid out byte for byte like
+// the GLSL side: vec3 takes 16 bytes unless a scalar fills its last 4, structs and arrays of them
+// start and end on 16. Change both sides together.
+
+// binding points of the blocks, set on every program after it's built
+enum UniformBlockBinding {
+    CAMERA_BLOCK,
+    LIGHTS_BLOCK,
+    DRAW_BLOCK
+};
+
+const char* const UNIFORM_BLOCK_NAMES[] = { "Camera", "Lights", "Draw" };
+
+// once per frame, read by every scene shader
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+struct DirLightBlock
+{
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct SpotLightBlock
+{
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct PointLightBlock
+{
+    glm::vec3 position;
+    float constant;
+    float linear;
+    float quadratic;
+    float pad0[2];
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+
+    static PointLightBlock from(const PointLight &light)
+    {
+        PointLightBlock block = {};
+        block.position = light.position;
+        block.constant = light.constant;
+        block.linear = light.linear;
+        block.quadratic = light.quadratic;
+        block.ambient = light.ambient;
+        block.diffuse = light.diffuse;
+        block.specular = light.specular;
+        return block;
+    }
+};
+
+// once per frame, read by the lit fragment shaders
+struct LightsBlock
+{
+    DirLightBlock dirLight;
+    SpotLightBlock spotLight;
+    PointLightBlock pointLights[MAX_POINT_LIGHTS];
+    int numPointLights;
+    int pad0[3];
+
+    void setPointLights(const std::vector<PointLight> &lights)
+    {
+        numPointLights = std::min((int)lights.size(), MAX_POINT_LIGHTS);
+        for (int i = 0; i < numPointLights; i++)
+            pointLights[i] = PointLightBlock::from(lights[i]);
+    }
+};
+
+// once per draw, bound with its own range
+struct DrawBlock
+{
+    glm::mat4 model;
+    glm::vec3 bakedAmbient;
+    int lightingLod;
+    int nearestPointLight;
+    int pad0[3];
+};
+
+// One frame's blocks in a FrameRing: Camera and Lights, then drawCount Draw blocks one bindable
+// stride apart. Everything is allocated up front so the Draw blocks can be written from any thread.
+struct FrameBlocks
+{
+    FrameRing* ring = nullptr;
+    FrameSpan camera;
+    FrameSpan lights;
+    FrameSpan draws;
+    size_t drawStride = 0;
+
+    static FrameBlocks begin(FrameRing &ring, size_t drawCount)
+    {
+        FrameBlocks blocks;
+        blocks.ring = &ring;
+        blocks.drawStride = ring.align(sizeof(DrawBlock));
+        ring.beginFrame(ring.align(sizeof(CameraBlock)) + ring.align(sizeof(LightsBlock)) + drawCount * blocks.drawStride);
+        blocks.camera = ring.allocate(sizeof(CameraBlock));
+        blocks.lights = ring.allocate(sizeof(LightsBlock));
+        blocks.draws = ring.allocate(drawCount * blocks.drawStride);
+        return blocks;
+    }
+
+    void writeDraw(size_t index, const DrawBlock &draw) const
+    {
+        draws.write(index * drawStride, draw);
+    }
+
+    // after FrameRing::commit(): the per-frame blocks, left bound for the whole frame
+    void bindFrame() const
+    {
+        ring->bind(CAMERA_BLOCK, camera);
+        ring->bind(LIGHTS_BLOCK, lights);
+    }
+
+    void bindDraw(size_t index) const
+    {
+        ring->bind(DRAW_BLOCK, draws, index * drawStride, sizeof(DrawBlock));
+    }
+};
+
+static_assert(sizeof(CameraBlock) == 144, "std140 layout of Camera");
+static_assert(sizeof(DirLightBlock) == 64 && sizeof(SpotLightBlock) == 96 && sizeof(PointLightBlock) == 80, "std140 layout of the light structs");
+static_assert(sizeof(LightsBlock) == 160 + 80 * MAX_POINT_LIGHTS + 16, "std140 layout of Lights");
+static_assert(sizeof(DrawBlock) == 96, "std140 layout of Draw");
+#endif
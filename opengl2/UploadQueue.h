@@ -0,0 +1,500 @@
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+#include "GLExtensions.h"
+#include "JobSystem.h"
+#include "LoadReport.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// uploads of one object still to go, e.g. the three buffers of a mesh
+struct UploadTicket
+{
+    std::atomic<int> pending{0};
+
+    bool done() const
+    {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+};
+
+// Streams textures and buffers to GL a frame budget at a time instead of in one blocking call.
+//
+// Data goes through a ring of staging memory in one buffer object: GL copies from the ring into
+// the texture (bound as GL_PIXEL_UNPACK_BUFFER) or buffer (glCopyBufferSubData), and a fence after
+// each frame's copies tells when that part of the ring can be written again. With buffer storage
+// (GL 4.4) the ring stays mapped the whole time, so image decoders on the job system copy their
+// result straight into it; without, drain() maps the range it writes, unsynchronized since the
+// fences already say the GPU is done with it.
+//
+// Textures are decoded on the job system and stay incomplete, sampling black, until their last row
+// is uploaded and the mipmaps built. Buffers are sized right away and filled later; their ticket
+// says when a draw can use them. Before init() and after release() everything uploads directly.
+class UploadQueue
+{
+public:
+    static UploadQueue& get()
+    {
+        static UploadQueue instance;
+        return instance;
+    }
+
+    // how much drain() uploads per frame, whichever runs out first. A staged texture goes in one
+    // copy and may overshoot the bytes.
+    size_t frameBytes = 8 * 1024 * 1024;
+    double frameMs = 2.0;
+
+    // creates the staging ring, call with the context current
+    void init(size_t ringBytes = 32 * 1024 * 1024)
+    {
+        MEMORY_TAG("uploads", "staging ring");
+        capacity = ringBytes;
+        glGenBuffers(1, &ring);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+        if (glExt.bufferStorage)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glExt.BufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity, NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity, flags);
+            if (!mapped)
+                std::cout << "ERROR::UPLOAD_QUEUE::MAP_FAILED" << std::endl;
+        }
+        else
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    bool isRunning() const
+    {
+        return ring != 0;
+    }
+
+    // a texture from an image file, filled in over the next frames. Reads only the header here.
+    GLuint loadTexture(const std::string &path)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        int width, height, components;
+        if (!stbi_info(path.c_str(), &width, &height, &components))
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return texture;
+        }
+        std::unique_ptr<Request> request(new Request());
+        request->texture = texture;
+        request->path = path;
+        request->width = width;
+        request->height = height;
+        request->components = components;
+        request->rowBytes = (size_t)width * components;
+        request->bytes = request->rowBytes * height;
+
+        // storage now so it's charged to the caller's tag; no mipmaps yet keeps it incomplete
+        GLenum format = formatFor(components);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        Request *decoding = request.get();
+        requests.push_back(std::move(request));
+        // without workers the job would only run once something waits on it
+        if (JobSystem::get().threadCount() > 1)
+            JobSystem::get().run([this, decoding] { decode(*decoding); }, &decodes);
+        else
+            decode(*decoding);
+        return texture;
+    }
+
+    // fills the first bytes of buffer, which the caller has sized with glBufferData(.., NULL, ..),
+    // from a copy of data taken now
+    void uploadBuffer(GLuint buffer, const void *data, size_t bytes, const std::shared_ptr<UploadTicket> &ticket)
+    {
+        if (bytes == 0)
+            return;
+        std::unique_ptr<Request> request(new Request());
+        request->buffer = buffer;
+        request->bytes = bytes;
+        request->ticket = ticket;
+        ticket->pending.fetch_add(1, std::memory_order_relaxed);
+        if (!stage(*request, data))
+            request->copy.assign((const unsigned char*)data, (const unsigned char*)data + bytes);
+        request->ready.store(true, std::memory_order_release);
+        requests.push_back(std::move(request));
+    }
+
+    // uploads within the frame budget, in the order things were queued. Call once per frame on
+    // the thread with the context.
+    void drain()
+    {
+        drain(frameBytes, frameMs);
+    }
+
+    void drain(size_t byteBudget, double msBudget)
+    {
+        if (!isRunning())
+            return;
+        PROFILE_SCOPE("upload queue");
+        auto start = std::chrono::steady_clock::now();
+        retire();
+        if (requests.empty())
+            return;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+        glBindBuffer(GL_COPY_READ_BUFFER, ring);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        size_t spent = 0;
+        bool submitted = false;
+        for (auto it = requests.begin(); it != requests.end() && spent < byteBudget && LoadReport::msSince(start) < msBudget;)
+        {
+            Request &request = **it;
+            if (!request.ready.load(std::memory_order_acquire))
+            {
+                ++it;
+                continue;
+            }
+            if (!request.failed)
+            {
+                size_t before = request.uploaded;
+                // out of ring space until earlier copies finish; staged requests further on can
+                // still go, and have to, their ring space is only freed once they're submitted
+                if (!upload(request, byteBudget - spent))
+                {
+                    ++it;
+                    continue;
+                }
+                spent += request.uploaded - before;
+                submitted = true;
+            }
+            if (request.failed || request.uploaded == request.bytes)
+            {
+                complete(request);
+                it = requests.erase(it);
+            }
+        }
+        if (submitted)
+        {
+            fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), drainSerial });
+            drainSerial++;
+        }
+        uploadedBytes += spent;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // uploads everything queued, waiting for decodes and the GPU as needed
+    void flush()
+    {
+        if (!isRunning())
+            return;
+        JobSystem::get().wait(decodes);
+        while (!requests.empty())
+        {
+            drain(SIZE_MAX, 1e30);
+            if (requests.empty() || fences.empty())
+                break;
+            glClientWaitSync(fences.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        }
+    }
+
+    // queued uploads not finished yet, including textures still decoding
+    size_t pendingCount() const
+    {
+        return requests.size();
+    }
+
+    size_t pendingBytes() const
+    {
+        size_t bytes = 0;
+        for (const std::unique_ptr<Request> &request : requests)
+            bytes += request->bytes - request->uploaded;
+        return bytes;
+    }
+
+    // bytes copied out of the ring since init()
+    uint64_t totalUploaded() const
+    {
+        return uploadedBytes;
+    }
+
+    // drops what's still queued and deletes the ring, call while the context is still current
+    void release()
+    {
+        if (!isRunning())
+            return;
+        JobSystem::get().wait(decodes);
+        requests.clear();
+        for (const Fence &fence : fences)
+            glDeleteSync(fence.sync);
+        fences.clear();
+        allocations.clear();
+        completedSerial = drainSerial - 1;
+        if (mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &ring);
+        ring = 0;
+        mapped = nullptr;
+        head = tail = used = 0;
+    }
+
+private:
+    struct Request
+    {
+        // a texture or a buffer
+        GLuint texture = 0;
+        GLuint buffer = 0;
+        std::string path;
+        int width = 0, height = 0, components = 0;
+        // upload granularity, a row of pixels or a byte
+        size_t rowBytes = 1;
+        size_t bytes = 0;
+        size_t uploaded = 0;
+        std::shared_ptr<UploadTicket> ticket;
+
+        // set by the decoder, or right away for buffers. The fields below are written before.
+        std::atomic<bool> ready{false};
+        bool failed = false;
+        // the whole upload already sits in the ring at stagingOffset
+        bool staged = false;
+        size_t stagingOffset = 0;
+        uint64_t stagingAllocation = 0;
+        // otherwise the data is here, decoded pixels or a copy of the buffer
+        unsigned char *pixels = nullptr;
+        TrackedVector<unsigned char> copy;
+
+        const unsigned char* source() const
+        {
+            return pixels ? pixels : copy.data();
+        }
+
+        ~Request()
+        {
+            if (pixels)
+                stbi_image_free(pixels);
+        }
+    };
+
+    // a piece of the ring, reusable once the fence of the drain that submitted it has passed
+    struct Allocation
+    {
+        uint64_t id;
+        // bytes taken including any skipped at the end of the ring, and where the piece ends
+        size_t size;
+        size_t end;
+        bool submitted;
+        uint64_t serial;
+    };
+
+    struct Fence
+    {
+        GLsync sync;
+        uint64_t serial;
+    };
+
+    GLuint ring = 0;
+    unsigned char *mapped = nullptr;
+    size_t capacity = 0;
+    // in flight between tail and head, used tells a full ring from an empty one
+    size_t head = 0, tail = 0, used = 0;
+    std::deque<Allocation> allocations;
+    uint64_t nextAllocation = 1;
+    // decoders allocate from the ring too
+    std::mutex ringMutex;
+
+    std::deque<Fence> fences;
+    uint64_t drainSerial = 1;
+    uint64_t completedSerial = 0;
+    std::list<std::unique_ptr<Request>> requests;
+    JobCounter decodes;
+    uint64_t uploadedBytes = 0;
+
+    static GLenum formatFor(int components)
+    {
+        return components == 1 ? GL_RED : components == 2 ? GL_RG : components == 3 ? GL_RGB : GL_RGBA;
+    }
+
+    // job system: decodes the image, straight into the ring when it's mapped and has room
+    void decode(Request &request)
+    {
+        {
+            LOAD_PHASE(LOAD_IMAGE_DECODE, request.path.c_str());
+            if (LoadReport::isEnabled())
+                LoadReport::addBytesRead(request.path, LoadReport::fileSize(request.path));
+            int width, height, components;
+            request.pixels = stbi_load(request.path.c_str(), &width, &height, &components, 0);
+            if (!request.pixels || width != request.width || height != request.height || components != request.components)
+            {
+                std::cout << "Texture failed to load at path: " << request.path << std::endl;
+                request.failed = true;
+            }
+            else if (stage(request, request.pixels))
+            {
+                stbi_image_free(request.pixels);
+                request.pixels = nullptr;
+            }
+        }
+        request.ready.store(true, std::memory_order_release);
+    }
+
+    // copies the whole upload into the persistently mapped ring, if there is room
+    bool stage(Request &request, const void *data)
+    {
+        if (!mapped || request.bytes > capacity / 4)
+            return false;
+        size_t offset;
+        uint64_t id;
+        if (!allocate(request.bytes, offset, id))
+            return false;
+        std::memcpy(mapped + offset, data, request.bytes);
+        request.staged = true;
+        request.stagingOffset = offset;
+        request.stagingAllocation = id;
+        return true;
+    }
+
+    // the next part of request, at most allowance bytes but always a whole row. False when the
+    // ring has no room for it.
+    bool upload(Request &request, size_t allowance)
+    {
+        if (request.staged)
+        {
+            copyFromRing(request, request.stagingOffset, request.bytes);
+            submit(request.stagingAllocation);
+            return true;
+        }
+        size_t rows = std::max<size_t>(1, std::min(allowance, capacity / 4) / request.rowBytes);
+        size_t bytes = std::min(rows * request.rowBytes, request.bytes - request.uploaded);
+        size_t offset;
+        uint64_t id;
+        if (!allocate(bytes, offset, id))
+            return false;
+        if (mapped)
+            std::memcpy(mapped + offset, request.source() + request.uploaded, bytes);
+        else
+        {
+            void *target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (target)
+                std::memcpy(target, request.source() + request.uploaded, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        copyFromRing(request, offset, bytes);
+        submit(id);
+        return true;
+    }
+
+    // GL copies bytes at the ring offset into the next part of the request's texture or buffer
+    void copyFromRing(Request &request, size_t offset, size_t bytes)
+    {
+        if (request.texture)
+        {
+            glBindTexture(GL_TEXTURE_2D, request.texture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)(request.uploaded / request.rowBytes), request.width, (GLsizei)(bytes / request.rowBytes),
+                            formatFor(request.components), GL_UNSIGNED_BYTE, (const void*)offset);
+        }
+        else
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, request.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, request.uploaded, bytes);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        request.uploaded += bytes;
+    }
+
+    void complete(Request &request)
+    {
+        if (request.texture && !request.failed)
+        {
+            glBindTexture(GL_TEXTURE_2D, request.texture);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        if (request.ticket)
+            request.ticket->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    // contiguous ring space at the head, skipping the end of the ring if it's too short
+    bool allocate(size_t bytes, size_t &offset, uint64_t &id)
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        // keep copies 64 byte aligned
+        bytes = (bytes + 63) & ~(size_t)63;
+        size_t skipped = 0;
+        if (used == 0)
+            head = tail = 0;
+        if (head >= tail && used < capacity)
+        {
+            if (capacity - head < bytes)
+            {
+                if (tail < bytes)
+                    return false;
+                skipped = capacity - head;
+                head = 0;
+            }
+        }
+        else if (tail - head < bytes)
+            return false;
+        offset = head;
+        head = (head + bytes) % capacity;
+        used += bytes + skipped;
+        id = nextAllocation++;
+        allocations.push_back({ id, bytes + skipped, offset + bytes, false, 0 });
+        return true;
+    }
+
+    // the allocation is read by the copies of the drain in progress
+    void submit(uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        for (Allocation &allocation : allocations)
+            if (allocation.id == id)
+            {
+                allocation.submitted = true;
+                allocation.serial = drainSerial;
+                return;
+            }
+    }
+
+    // frees the ring space of every drain whose copies the GPU has finished
+    void retire()
+    {
+        while (!fences.empty())
+        {
+            GLenum status = glClientWaitSync(fences.front().sync, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+            completedSerial = fences.front().serial;
+            glDeleteSync(fences.front().sync);
+            fences.pop_front();
+        }
+        std::lock_guard<std::mutex> lock(ringMutex);
+        // in allocation order, a piece staged by a decoder but not submitted yet holds up the rest
+        while (!allocations.empty() && allocations.front().submitted && allocations.front().serial <= completedSerial)
+        {
+            used -= allocations.front().size;
+            tail = allocations.front().end % capacity;
+            allocations.pop_front();
+        }
+    }
+};
+#endif
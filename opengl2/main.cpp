@@ -12,12 +12,40 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "GLExtensions.h"
 #include "Shader.h"
 #include "Camera.h"
 #include "Model.h"
+#include "ShaderLod.h"
+#include "DrawList.h"
+#include "Profiler.h"
+#include "HeadlessContext.h"
+#include "Benchmark.h"
+#include "GLCounters.h"
+#include "GLCapture.h"
+#include "NullGL.h"
+#include "SceneGen.h"
+#include "CameraRecorder.h"
+#include "Hud.h"
+#include "HitchDetector.h"
+#include "MemoryTracker.h"
+#include "OverdrawHeatmap.h"
+#include "LoadReport.h"
+#include "JobSystem.h"
+#include "SimState.h"
+#include "UploadQueue.h"
+#include "FrameRing.h"
+#include "UniformBlocks.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include<iostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 
 
@@ -26,6 +54,13 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
+void reportPrepassMode();
+void applyRenderRequests();
+void bindUniformBlocks(const Shader &shader);
+void writeFrameBlocks(const FrameBlocks &blocks, const glm::mat4 &view, const glm::mat4 &projection, const Camera &frameCamera,
+                      bool flashlight, const std::vector<PointLight> &pointLights);
+DrawBlock drawBlockFor(const DrawCommand &draw);
+int runReplay(const std::string &path, Benchmark &bench);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -37,6 +72,12 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// camera path recording (--record) and fixed-timestep playback (--play). While a path plays,
+// live mouse and movement input is ignored.
+CameraRecorder cameraRecorder;
+CameraPath cameraPath;
+bool playingPath = false;
+
 // timing
 float deltaTime = 0.0f;    // time between current frame and last frame
 float lastFrame = 0.0f;
@@ -46,10 +87,192 @@ glm::vec3 lightPos(-1.5f, 0.5f, 2.0f);
 bool isOn = false;
 bool keyPressed = false;
 
-int main()
+// simulation on the main thread at a fixed tick while a render thread draws (--sim-thread). The
+// renderer draws the snapshots the simulation publishes, interpolated one tick in the past.
+bool simThreaded = false;
+double simTick = 1.0 / 120.0;
+TripleBuffer<SimSnapshot> simSnapshots;
+// set by the resize callback, which GLFW runs on the main thread
+std::atomic<int> framebufferWidth{(int)SCR_WIDTH};
+std::atomic<int> framebufferHeight{(int)SCR_HEIGHT};
+
+// key presses for state the renderer owns, applied by applyRenderRequests() at the start of its
+// next frame so input can run on another thread
+struct RenderRequests
+{
+    std::atomic<int> hud{0};
+    std::atomic<int> heatmap{0};
+    std::atomic<int> prepass{0};
+    std::atomic<int> memoryReport{0};
+};
+RenderRequests renderRequests;
+
+// stats overlay, toggled with H
+Hud hud;
+bool hKeyPressed = false;
+// M prints the memory report
+bool mKeyPressed = false;
+// overdraw / lights evaluated heatmap, cycled with O
+OverdrawHeatmap heatmap;
+bool oKeyPressed = false;
+
+// lighting level of detail
+LodSelector lodSelector;
+LodStats lodStats;
+
+// depth pre-pass, toggled with Z. Frame time and shaded samples are accumulated per mode so
+// the effect of switching can be compared.
+bool zPrepass = false;
+bool zKeyPressed = false;
+double modeFrameTime = 0.0;
+uint64_t modeSamples = 0;
+int modeFrames = 0;
+
+int main(int argc, char** argv)
 {
+    auto startTime = std::chrono::steady_clock::now();
+    // command line: --profile [trace.json] records CPU/GPU scopes and writes a Chrome trace on exit
+    //               --bench renders offscreen along a fixed camera path and prints timings as JSON
+    //               --frames N, --warmup N: length of the benchmark run
+    //               --zprepass starts with the depth pre-pass enabled
+    //               --gl-stats [gl_stats.csv] counts GL calls per frame and writes them as CSV
+    //               --capture file [--capture-frames N] records the GL calls of the first N frames
+    //               --replay file re-executes a capture offscreen and prints timings like --bench
+    //               --null runs --bench on the null GL backend, measuring only our own CPU cost
+    //               --objects N draws N cubes instead of 13, the extra ones on a grid behind the scene
+    //               --cubes N, --lights N (max 32), --models N, --seed N generate a stress scene instead,
+    //               --scene file reads the same keys from "key = value" lines
+    //               --record file saves the camera state of every frame
+    //               --play file [--timestep S] drives the camera from a recording, S seconds per frame;
+    //               with --bench the run lasts the whole recording unless --frames is given
+    //               --hitches [hitches.log] logs frames over 2x the median frame time with what ran in them
+    //               --memory tracks GPU memory per subsystem and asset and prints the report on exit
+    //               (always tracked in a window, press M for the report)
+    //               --load-report prints startup time per phase and per asset, with bytes read and uploaded
+    //               --sim-thread [--sim-hz N] runs input and simulation at N ticks per second (default
+    //               120) on the main thread and renders on a second one, interpolating between ticks
+    //               --sync-uploads loads textures and meshes in full before the first frame; otherwise a
+    //               window streams them in, --upload-budget-mb N per frame (default 8)
+    //               --threads N runs jobs on N threads including the main one (default one per core),
+    //               --pin-threads ties each of them to a core
+    //               --frames-in-flight N lets the CPU write uniforms up to N frames ahead of the GPU (default 3)
+    std::string tracePath;
+    std::string glStatsPath;
+    std::string capturePath;
+    std::string replayPath;
+    std::string hitchPath;
+    int captureFrames = 100;
+    bool warmupSet = false;
+    bool framesSet = false;
+    std::string recordPath;
+    std::string playPath;
+    bool nullBackend = false;
+    bool memoryReport = false;
+    int objectCount = 13;
+    unsigned jobThreads = 0;
+    bool pinThreads = false;
+    bool syncUploads = false;
+    int framesInFlight = 3;
+    SceneParams sceneParams;
+    bool benchMode = false;
+    Benchmark bench;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--profile")
+        {
+            tracePath = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "trace.json";
+            Profiler::get().setEnabled(true);
+            Profiler::get().keepGpuHistory(true);
+        }
+        else if (arg == "--bench")
+            benchMode = true;
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            bench.frames = std::max(1, std::atoi(argv[++i]));
+            framesSet = true;
+        }
+        else if (arg == "--warmup" && i + 1 < argc)
+        {
+            bench.warmup = std::max(0, std::atoi(argv[++i]));
+            warmupSet = true;
+        }
+        else if (arg == "--zprepass")
+            zPrepass = true;
+        else if (arg == "--gl-stats")
+            glStatsPath = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "gl_stats.csv";
+        else if (arg == "--hitches")
+            hitchPath = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "hitches.log";
+        else if (arg == "--memory")
+            memoryReport = true;
+        else if (arg == "--load-report")
+            LoadReport::enable();
+        else if (arg == "--capture" && i + 1 < argc)
+            capturePath = argv[++i];
+        else if (arg == "--capture-frames" && i + 1 < argc)
+            captureFrames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+            benchMode = true;
+        }
+        else if (arg == "--null")
+        {
+            nullBackend = true;
+            benchMode = true;
+        }
+        else if (arg == "--objects" && i + 1 < argc)
+            objectCount = std::max(0, std::atoi(argv[++i]));
+        else if ((arg == "--cubes" || arg == "--lights" || arg == "--models" || arg == "--seed") && i + 1 < argc)
+            sceneParams.set(arg.substr(2), std::atol(argv[++i]));
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--play" && i + 1 < argc)
+            playPath = argv[++i];
+        else if (arg == "--timestep" && i + 1 < argc)
+            cameraPath.timestep = std::max(1e-4, std::atof(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            jobThreads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--pin-threads")
+            pinThreads = true;
+        else if (arg == "--sync-uploads")
+            syncUploads = true;
+        else if (arg == "--upload-budget-mb" && i + 1 < argc)
+            UploadQueue::get().frameBytes = (size_t)(std::max(0.1, std::atof(argv[++i])) * 1024 * 1024);
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+            framesInFlight = std::clamp(std::atoi(argv[++i]), 1, 8);
+        else if (arg == "--sim-thread")
+            simThreaded = true;
+        else if (arg == "--sim-hz" && i + 1 < argc)
+            simTick = 1.0 / std::max(1.0, std::atof(argv[++i]));
+        else if (arg == "--scene" && i + 1 < argc)
+        {
+            if (!sceneParams.loadConfig(argv[++i]))
+                return -1;
+        }
+    }
+
+    if (!playPath.empty())
+    {
+        if (!cameraPath.load(playPath))
+            return -1;
+        playingPath = true;
+        if (!framesSet)
+            bench.frames = cameraPath.frameCount();
+    }
+    if (!recordPath.empty() && !cameraRecorder.open(recordPath))
+        return -1;
+    JobSystem::get().init(jobThreads, pinThreads);
+    // benchmarks, path playback and captures need exactly one simulation step per frame
+    if (simThreaded && (benchMode || !playPath.empty() || !capturePath.empty()))
+    {
+        std::cout << "--sim-thread only applies to interactive runs, ignored" << std::endl;
+        simThreaded = false;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
+    auto contextStart = std::chrono::steady_clock::now();
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -59,30 +282,98 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
+    // glfw window creation, or an offscreen context for benchmark runs
     // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
+    GLFWwindow* window = NULL;
+    HeadlessContext headless;
+    GLADloadproc loader = (GLADloadproc)glfwGetProcAddress;
+    if (nullBackend)
+        loader = &NullGL::loader;
+    else if (benchMode)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        if (!headless.create(SCR_WIDTH, SCR_HEIGHT))
+        {
+            std::cout << "Failed to create offscreen context" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        loader = headless.loader();
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    else
+    {
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
 
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        framebufferWidth = width;
+        framebufferHeight = height;
+    }
+    LoadReport::add(LOAD_CONTEXT, "", LoadReport::msSince(contextStart));
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    auto gladStart = std::chrono::steady_clock::now();
+    if (!gladLoadGLLoader(loader))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    loadGLExtensions(loader);
+    LoadReport::add(LOAD_GLAD, "", LoadReport::msSince(gladStart));
+    if (memoryReport || !benchMode)
+        MemoryTracker::installGL();
+    if (!glStatsPath.empty())
+    {
+        GLCounters::install();
+        GLCounters::openCsv(glStatsPath);
+    }
+    if (!hitchPath.empty())
+    {
+        GLCounters::install();
+        if (!HitchDetector::enable(hitchPath))
+            return -1;
+    }
+    if (!replayPath.empty())
+    {
+        // the first replayed frame also creates every resource, don't count it
+        if (!warmupSet)
+            bench.warmup = 1;
+        int result = runReplay(replayPath, bench);
+        GLCounters::closeCsv();
+        headless.destroy();
+        glfwTerminate();
+        return result;
+    }
+    if (!capturePath.empty())
+    {
+        // program binaries and separable pipelines are driver specific, capture plain GLSL builds
+        ShaderCache::directory().clear();
+        Shader::useSeparablePrograms() = false;
+        GLCapture::install(capturePath, captureFrames);
+    }
+    if (glExt.parallelShaderCompile)
+        glExt.MaxShaderCompilerThreads(0xFFFFFFFF);
+    if (!benchMode)
+    {
+        hud.init();
+        hud.passes = { "depth prepass", "ground", "cubes", "backpack" };
+        heatmap.init();
+    }
+    // benchmarks and captures need every frame to draw the same complete scene
+    if (!benchMode && capturePath.empty() && !syncUploads)
+        UploadQueue::get().init();
     stbi_set_flip_vertically_on_load(true);
     glEnable(GL_DEPTH_TEST);
     // configure global opengl state
@@ -90,13 +381,27 @@ int main()
     //glEnable(GL_DEPTH_TEST);
     // build and compile our shader zprogram
     // ------------------------------------
-    Shader my_shader("v_shader", "f_shader");
-    Shader cube_shader("cube_v_shader", "cube_f_shader");
-    Shader backpack_shader("backpack_v", "backpack_f");
+    // the builds are only issued here (or restored from shader_cache/), the driver compiles them
+    // in the background while the model loads and finish() collects the results afterwards
+    Shader my_shader("v_shader", "f_shader", true);
+    Shader cube_shader("cube_v_shader", "cube_f_shader", true);
+    Shader backpack_shader("backpack_v", "backpack_f", true);
+    Shader depth_shader("depth_v", "depth_f", true);
     Model my_model("backpack/backpack.obj");
+    my_shader.finish();
+    cube_shader.finish();
+    backpack_shader.finish();
+    depth_shader.finish();
+    for (const Shader* shader : { &my_shader, &cube_shader, &backpack_shader, &depth_shader })
+        bindUniformBlocks(*shader);
+    // camera, lights and per-draw uniforms of the scene shaders, written a frame at a time while
+    // the GPU still reads up to framesInFlight - 1 earlier ones. Captures need the data in GL calls.
+    FrameRing frameRing;
+    frameRing.init(256 * 1024, framesInFlight, capturePath.empty());
     
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
+    MEMORY_TAG("scene", "ground and cubes");
     
     float vertices[] = {
            // positions          // texture coords
@@ -192,8 +497,41 @@ int main()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
     glEnableVertexAttribArray(2);
     
+    // position-only copy of the cube for the depth pre-pass
+    float cube_positions[36 * 3];
+    for (int i = 0; i < 36; ++i)
+        for (int j = 0; j < 3; ++j)
+            cube_positions[i * 3 + j] = cube_vertices[i * 8 + j];
+    
+    unsigned int cube_depth_VBO, cube_depth_VAO;
+    glGenVertexArrays(1, &cube_depth_VAO);
+    glGenBuffers(1, &cube_depth_VBO);
+    glBindVertexArray(cube_depth_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cube_depth_VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cube_positions), cube_positions, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
     
     
+    
+    // run every program once so the first real frame doesn't pay for draw-time compilation,
+    // with zeroed blocks bound so no shader reads an unbacked one
+    {
+        FrameBlocks blocks = FrameBlocks::begin(frameRing, 1);
+        blocks.camera.write(0, CameraBlock());
+        blocks.lights.write(0, LightsBlock());
+        blocks.writeDraw(0, DrawBlock());
+        frameRing.commit();
+        blocks.bindFrame();
+        blocks.bindDraw(0);
+        my_shader.warmUp(VAO);
+        cube_shader.warmUp(cube_VAO);
+        if (!my_model.meshes.empty())
+            backpack_shader.warmUp(my_model.meshes[0].VAO_bp);
+        depth_shader.warmUp(cube_depth_VAO);
+        frameRing.endFrame();
+    }
+    
     unsigned int texture = loadTexture("grass.jpg");
     unsigned int cube_texture = loadTexture("container2.png");
     unsigned int spec_texture = loadTexture("container2_specular.png");
@@ -203,245 +541,372 @@ int main()
     cube_shader.use();
     cube_shader.setInt("material.diffuse", 1);
     cube_shader.setInt("material.specular", 2);
+    cube_shader.setFloat("material.shininess", 32.0f);
+    backpack_shader.use();
+    backpack_shader.setFloat("material.shininess", 32.0f);
+    
+    if (benchMode && !bench.createTarget(SCR_WIDTH, SCR_HEIGHT))
+        return -1;
     
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     // render loop
     // -----------
     
-    glm::vec3 cubePositions[] = {
-          glm::vec3(  2.0f,  -0.5f,  0.0f),
-          glm::vec3(  2.0f,  -0.5f, -1.0f),
-          glm::vec3(  2.0f,  -0.5f, -2.0f),
-          glm::vec3(  2.0f,  -0.5f, -3.0f),
-          glm::vec3(  2.0f,  -0.5f, -4.0f),
-          glm::vec3( -2.0f,  -0.5f,  0.0f),
-          glm::vec3( -2.0f,  -0.5f, -1.0f),
-          glm::vec3( -2.0f,  -0.5f, -2.0f),
-          glm::vec3( -2.0f,  -0.5f, -3.0f),
-          glm::vec3( -2.0f,  -0.5f, -4.0f),
-
-          glm::vec3(  0.0f, -0.5f, -4.0f),
-          glm::vec3(  1.0f, -0.5f, -4.0f),
-          glm::vec3( -1.0f, -0.5f, -4.0f),
-      };
-    
-    glm::vec3 pointLightPositions[] = {
-           glm::vec3( 0.7f,  0.2f,  2.0f),
-           glm::vec3( 2.3f, -3.3f, -4.0f),
-           glm::vec3(-4.0f,  2.0f, -12.0f),
-           glm::vec3( 0.0f,  0.0f, -3.0f)
-       };
+    Scene scene = sceneParams.generated() ? SceneGen::generate(sceneParams) : SceneGen::handMade(objectCount);
+    const std::vector<glm::vec3> &cubePositions = scene.cubes;
+    // a fully lit fragment evaluates the directional light, every point light and the flashlight,
+    // red is twice that
+    heatmap.maxLights = 2.0f * (scene.lights.size() + 2);
+
+    // current lighting level per object, kept across frames for hysteresis
+    std::vector<int> cubeLod(cubePositions.size(), LOD_FULL);
+    std::vector<int> backpackLod(scene.models.size(), LOD_FULL);
+    const float cubeRadius = 0.866f; // half the diagonal of a unit cube
+    // the frame's visible cubes and backpacks, recorded on the job system and drawn in key order
+    DrawList drawList;
+    int pathFrame = 0;
+    double recordClock = 0.0;
+    // context creation, shader builds, model and texture loading, up to the first frame
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    LoadReport::finish(std::cout, loadMs);
 
 
     
-    while (!glfwWindowShouldClose(window))
+    // what each frame is drawn from: the live camera, or the simulation's snapshots
+    Camera frameCamera = camera;
+    bool flashlight = isOn;
+    float frameDelta = 0.0f;
+    SimSnapshot previousSnapshot, currentSnapshot;
+    double lastRenderTime = 0.0;
+    int viewportWidth = framebufferWidth, viewportHeight = framebufferHeight;
+
+    auto renderLoop = [&]()
     {
+        while (benchMode ? !bench.finished() : !glfwWindowShouldClose(window))
+        {
+            auto frameStart = std::chrono::steady_clock::now();
+            HitchDetector::beginFrame();
+            if (benchMode)
+            {
+                // fixed step and camera path, so every run draws exactly the same frames
+                deltaTime = playingPath ? (float)cameraPath.timestep : 1.0f / 60.0f;
+                if (playingPath)
+                    cameraPath.apply(std::min(bench.pathFrame(), cameraPath.frameCount() - 1), camera, isOn);
+                else
+                    bench.placeCamera(camera);
+                bench.beginFrame();
+            }
+            else if (playingPath)
+            {
+                deltaTime = (float)cameraPath.timestep;
+                cameraPath.apply(pathFrame, camera, isOn);
+                if (cameraPath.finished(++pathFrame))
+                    glfwSetWindowShouldClose(window, true);
+                processInput(window);
+            }
+            else if (simThreaded)
+            {
+                // the camera belongs to the simulation thread, draw from its snapshots
+                double now = glfwGetTime();
+                frameDelta = (float)(now - lastRenderTime);
+                lastRenderTime = now;
+                if (simSnapshots.update())
+                {
+                    previousSnapshot = currentSnapshot;
+                    currentSnapshot = simSnapshots.front();
+                }
+                SimSnapshot shown = SimSnapshot::interpolate(previousSnapshot, currentSnapshot, now - simTick);
+                shown.apply(frameCamera);
+                flashlight = shown.flashlight;
+            }
+            else
+            {
+                float current_frame = static_cast<float>(glfwGetTime());
+                deltaTime = current_frame - lastFrame;
+                lastFrame = current_frame;
+                PROFILE_SCOPE("processInput");
+                processInput(window);
+            }
+            if (!simThreaded)
+            {
+                frameCamera = camera;
+                flashlight = isOn;
+                frameDelta = deltaTime;
+                recordClock += deltaTime;
+                cameraRecorder.record(recordClock, camera, isOn);
+            }
+            applyRenderRequests();
+            UploadQueue::get().drain();
         
-        float current_frame = static_cast<float>(glfwGetTime());
-        deltaTime = current_frame - lastFrame;
-        lastFrame = current_frame;
-        processInput(window);
+            glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+            int width = SCR_WIDTH, height = SCR_HEIGHT;
+            if (!benchMode)
+            {
+                width = framebufferWidth;
+                height = framebufferHeight;
+                if (width != viewportWidth || height != viewportHeight)
+                {
+                    glViewport(0, 0, width, height);
+                    viewportWidth = width;
+                    viewportHeight = height;
+                }
+                heatmap.begin(width, height);
+            }
         
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+            glm::mat4 view = glm::mat4(1.0f);
+            glm::mat4 projection = glm::mat4(1.0f);
+            view = frameCamera.GetViewMatrix();
+            projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH/(float)SCR_HEIGHT, 0.1f, 100.0f);
+            glm::mat4 groundModel = glm::mat4(1.0f);
+            groundModel = glm::translate(groundModel, glm::vec3(0.0f, -1.0f, 0.0f));
+            groundModel = glm::rotate(groundModel, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            groundModel = glm::scale(groundModel, glm::vec3(200.0f, 200.0f, 0.0f));
+
+            {
+                PROFILE_SCOPE("record draws");
+                // LOD thresholds are in framebuffer pixels, which differ from SCR_HEIGHT on HiDPI displays and after a resize
+                DrawList::View drawView = { view, projection, (float)height, 100.0f, &lodSelector, &scene.lights };
+                drawList.record(drawView, cubePositions, cubeRadius, cubeLod, scene.models, my_model.boundsCenter, my_model.boundsRadius * 0.2f, backpackLod);
+            }
+            const auto &draws = drawList.sorted();
+            std::pair<size_t, size_t> cubeDraws = drawList.range(DRAW_CUBE);
+            std::pair<size_t, size_t> backpackDraws = drawList.range(DRAW_BACKPACK);
+            // Draw block 0 is the ground, 1 + i the i-th sorted draw
+            FrameBlocks blocks = FrameBlocks::begin(frameRing, draws.size() + 1);
+            {
+                PROFILE_SCOPE("write uniform blocks");
+                writeFrameBlocks(blocks, view, projection, frameCamera, flashlight, scene.lights);
+                DrawBlock ground = {};
+                ground.model = groundModel;
+                blocks.writeDraw(0, ground);
+                JobSystem::get().parallelFor(draws.size(), [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                        blocks.writeDraw(i + 1, drawBlockFor(*draws[i].command));
+                });
+                frameRing.commit();
+                blocks.bindFrame();
+            }
         
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
+            if (zPrepass)
+            {
+                // lay down depth with the cheap shader first, then shade only the visible surface
+                PROFILE_GPU_SCOPE("depth prepass");
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                depth_shader.use();
+                blocks.bindDraw(0);
+                // the ground VAO has positions at location 0 as well
+                glBindVertexArray(VAO);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                glBindVertexArray(cube_depth_VAO);
+                for (size_t i = cubeDraws.first; i < cubeDraws.second; i++)
+                {
+                    blocks.bindDraw(i + 1);
+                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                }
+                for (size_t i = backpackDraws.first; i < backpackDraws.second; i++)
+                {
+                    blocks.bindDraw(i + 1);
+                    my_model.DrawDepth();
+                }
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthMask(GL_FALSE);
+                glDepthFunc(GL_EQUAL);
+            }
         
-        my_shader.use();
-        glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 view = glm::mat4(1.0f);
-        glm::mat4 projection = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(200.0f, 200.0f, 0.0f));
-        view = camera.GetViewMatrix();
-        projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH/(float)SCR_HEIGHT, 0.1f, 100.0f);
+            {
+                PROFILE_GPU_SCOPE("ground");
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, texture);
         
-        my_shader.setMat4("model", model);
-        my_shader.setMat4("view", view);
-        my_shader.setMat4("projection", projection);
+                my_shader.use();
+                blocks.bindDraw(0);
         
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                glBindVertexArray(VAO);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            }
        
         
-        cube_shader.use();
-        cube_shader.setVec3("viewPos", camera.Position);
-        cube_shader.setFloat("material.shininess", 32.0f);
-        // directional light
-        cube_shader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        cube_shader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        cube_shader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        cube_shader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point light 1
-        cube_shader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        cube_shader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        cube_shader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        cube_shader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        cube_shader.setFloat("pointLights[0].constant", 1.0f);
-        cube_shader.setFloat("pointLights[0].linear", 0.09f);
-        cube_shader.setFloat("pointLights[0].quadratic", 0.032f);
-        // point light 2
-        cube_shader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        cube_shader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        cube_shader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        cube_shader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        cube_shader.setFloat("pointLights[1].constant", 1.0f);
-        cube_shader.setFloat("pointLights[1].linear", 0.09f);
-        cube_shader.setFloat("pointLights[1].quadratic", 0.032f);
-        // point light 3
-        cube_shader.setVec3("pointLights[2].position", pointLightPositions[2]);
-        cube_shader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-        cube_shader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-        cube_shader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-        cube_shader.setFloat("pointLights[2].constant", 1.0f);
-        cube_shader.setFloat("pointLights[2].linear", 0.09f);
-        cube_shader.setFloat("pointLights[2].quadratic", 0.032f);
-        // point light 4
-        cube_shader.setVec3("pointLights[3].position", pointLightPositions[3]);
-        cube_shader.setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-        cube_shader.setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-        cube_shader.setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-        cube_shader.setFloat("pointLights[3].constant", 1.0f);
-        cube_shader.setFloat("pointLights[3].linear", 0.09f);
-        cube_shader.setFloat("pointLights[3].quadratic", 0.032f);
-        // spotLight
+            {
+                PROFILE_GPU_SCOPE("cubes");
+                cube_shader.use();
         
-        if(isOn==false){
-            cube_shader.setVec3("spotLight.position", 0.0f, -20.0f, 0.0f);
-            cube_shader.setVec3("spotLight.direction", camera.Front);
-            cube_shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-            cube_shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-            cube_shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-            cube_shader.setFloat("spotLight.constant", 1.0f);
-            cube_shader.setFloat("spotLight.linear", 0.09f);
-            cube_shader.setFloat("spotLight.quadratic", 0.032f);
-            cube_shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-            cube_shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-            cube_shader.setMat4("view", view);
-            cube_shader.setMat4("projection", projection);
-        }
-        if(isOn==true){
-            cube_shader.setVec3("spotLight.position", camera.Position);
-            cube_shader.setVec3("spotLight.direction", camera.Front);
-            cube_shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-            cube_shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-            cube_shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-            cube_shader.setFloat("spotLight.constant", 1.0f);
-            cube_shader.setFloat("spotLight.linear", 0.09f);
-            cube_shader.setFloat("spotLight.quadratic", 0.032f);
-            cube_shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-            cube_shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-            cube_shader.setMat4("view", view);
-            cube_shader.setMat4("projection", projection);
-        }
-       
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, cube_texture);
         
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, cube_texture);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, spec_texture);
         
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, spec_texture);
+                glBindVertexArray(cube_VAO);
+                for (size_t i = cubeDraws.first; i < cubeDraws.second; i++)
+                {
+                    lodStats.setLevel(draws[i].command->lightingLod);
+                    blocks.bindDraw(i + 1);
+                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                }
+            }
         
-        glBindVertexArray(cube_VAO);
-        for(int i=0; i<13; ++i){
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            cube_shader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
         
+            {
+                PROFILE_GPU_SCOPE("backpack");
+                backpack_shader.use();
+                for (size_t i = backpackDraws.first; i < backpackDraws.second; i++)
+                {
+                    lodStats.setLevel(draws[i].command->lightingLod);
+                    blocks.bindDraw(i + 1);
+                    my_model.Draw(backpack_shader);
+                }
+            }
+            frameRing.endFrame();
+            lodStats.endFrame();
         
-        backpack_shader.use();
-        backpack_shader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        backpack_shader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        backpack_shader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        backpack_shader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point light 1
-        backpack_shader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        backpack_shader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        backpack_shader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        backpack_shader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        backpack_shader.setFloat("pointLights[0].constant", 1.0f);
-        backpack_shader.setFloat("pointLights[0].linear", 0.09f);
-        backpack_shader.setFloat("pointLights[0].quadratic", 0.032f);
-        // point light 2
-        backpack_shader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        backpack_shader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        backpack_shader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        backpack_shader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        backpack_shader.setFloat("pointLights[1].constant", 1.0f);
-        backpack_shader.setFloat("pointLights[1].linear", 0.09f);
-        backpack_shader.setFloat("pointLights[1].quadratic", 0.032f);
-        // point light 3
-        backpack_shader.setVec3("pointLights[2].position", pointLightPositions[2]);
-        backpack_shader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-        backpack_shader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-        backpack_shader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-        backpack_shader.setFloat("pointLights[2].constant", 1.0f);
-        backpack_shader.setFloat("pointLights[2].linear", 0.09f);
-        backpack_shader.setFloat("pointLights[2].quadratic", 0.032f);
-        // point light 4
-        backpack_shader.setVec3("pointLights[3].position", pointLightPositions[3]);
-        backpack_shader.setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-        backpack_shader.setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-        backpack_shader.setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-        backpack_shader.setFloat("pointLights[3].constant", 1.0f);
-        backpack_shader.setFloat("pointLights[3].linear", 0.09f);
-        backpack_shader.setFloat("pointLights[3].quadratic", 0.032f);
-        // spotLight
-        
-        if(isOn==false){
-            backpack_shader.setVec3("spotLight.position", 0.0f, -20.0f, 0.0f);
-            backpack_shader.setVec3("spotLight.direction", camera.Front);
-            backpack_shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-            backpack_shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-            backpack_shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-            backpack_shader.setFloat("spotLight.constant", 1.0f);
-            backpack_shader.setFloat("spotLight.linear", 0.09f);
-            backpack_shader.setFloat("spotLight.quadratic", 0.032f);
-            backpack_shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-            backpack_shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-            
-        }
-        if(isOn==true){
-            backpack_shader.setVec3("spotLight.position", camera.Position);
-            backpack_shader.setVec3("spotLight.direction", camera.Front);
-            backpack_shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-            backpack_shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-            backpack_shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-            backpack_shader.setFloat("spotLight.constant", 1.0f);
-            backpack_shader.setFloat("spotLight.linear", 0.09f);
-            backpack_shader.setFloat("spotLight.quadratic", 0.032f);
-            backpack_shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-            backpack_shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-            
-        }
-        backpack_shader.setVec3("viewPos", camera.Position);
-        backpack_shader.setFloat("material.shininess", 32.0f);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f));
-        model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-        backpack_shader.setMat4("model", model);
-        backpack_shader.setMat4("view", view);
-        backpack_shader.setMat4("projection", projection);
-        my_model.Draw(backpack_shader);
+            if (zPrepass)
+            {
+                glDepthMask(GL_TRUE);
+                glDepthFunc(GL_LESS);
+            }
+            heatmap.end();
+            modeFrameTime += frameDelta;
+            uint64_t frameSamples = 0;
+            for (uint64_t samples : lodStats.collected())
+                frameSamples += samples;
+            modeSamples += frameSamples;
+            modeFrames++;
         
         
         
         
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            Profiler::get().endFrame();
+            GLCounters::endFrame();
+            GLCapture::endFrame();
+            HitchDetector::endFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            if (benchMode)
+            {
+                bench.endFrame(frameSamples, GLCounters::lastFrame().drawCalls);
+                continue;
+            }
+            hud.addFrame(frameDelta * 1000.0f, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            if (heatmap.isEnabled())
+            {
+                char status[64];
+                std::snprintf(status, sizeof(status), "OVERDRAW %.2f  LIGHTS/FRAG %.1f", heatmap.fragmentsPerPixel(), heatmap.lightsPerFragment());
+                hud.status = status;
+            }
+            else if (UploadQueue::get().pendingCount() > 0)
+            {
+                char status[64];
+                std::snprintf(status, sizeof(status), "STREAMING %zu  %.1f MB", UploadQueue::get().pendingCount(),
+                              UploadQueue::get().pendingBytes() / (1024.0 * 1024.0));
+                hud.status = status;
+            }
+            else
+                hud.status.clear();
+            hud.draw(width, height);
+            glfwSwapBuffers(window);
+            if (!simThreaded)
+                glfwPollEvents();
+        }
+    };
+
+    if (simThreaded)
+    {
+        // the render thread takes the context, this one keeps the window's events and the input
+        lastRenderTime = glfwGetTime();
+        previousSnapshot = currentSnapshot = SimSnapshot::capture(lastRenderTime, camera, isOn);
+        glfwMakeContextCurrent(NULL);
+        std::thread renderThread([&] {
+            glfwMakeContextCurrent(window);
+            renderLoop();
+            glfwMakeContextCurrent(NULL);
+        });
+        double nextTick = lastRenderTime + simTick;
+        while (!glfwWindowShouldClose(window))
+        {
+            glfwWaitEventsTimeout(std::max(nextTick - glfwGetTime(), 0.0));
+            double now = glfwGetTime();
+            // after a stall, drop the time that can't be caught up quickly
+            nextTick = std::max(nextTick, now - 0.25);
+            while (nextTick <= now)
+            {
+                PROFILE_SCOPE("simulation tick");
+                deltaTime = (float)simTick;
+                processInput(window);
+                recordClock += simTick;
+                cameraRecorder.record(recordClock, camera, isOn);
+                simSnapshots.back() = SimSnapshot::capture(nextTick, camera, isOn);
+                simSnapshots.publish();
+                nextTick += simTick;
+            }
+        }
+        renderThread.join();
+        glfwMakeContextCurrent(window);
     }
+    else
+        renderLoop();
 
     glDeleteVertexArrays(1,&VAO);
     glDeleteVertexArrays(1,&cube_VAO);
+    glDeleteVertexArrays(1,&cube_depth_VAO);
   
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &cube_VBO);
+    glDeleteBuffers(1, &cube_depth_VBO);
  
     glDeleteBuffers(1, &EBO);
+    if (benchMode)
+    {
+        std::string fields = std::string("\"z_prepass\": ") + (zPrepass ? "true" : "false")
+            + ", \"load_time_ms\": " + std::to_string(loadMs)
+            + ", \"objects\": " + std::to_string(cubePositions.size() + scene.models.size() + 1)
+            + ", \"cubes\": " + std::to_string(cubePositions.size())
+            + ", \"lights\": " + std::to_string(scene.lights.size())
+            + ", \"models\": " + std::to_string(scene.models.size())
+            + ", \"backend\": \"" + (nullBackend ? "null" : "gl") + "\""
+            + ", \"threads\": " + std::to_string(JobSystem::get().threadCount());
+        if (sceneParams.generated())
+            fields += ", \"seed\": " + std::to_string(sceneParams.seed);
+        if (playingPath)
+            fields += ", \"camera_path\": \"" + playPath + "\"";
+        fields += ", \"frames_in_flight\": " + std::to_string(frameRing.framesInFlight())
+            + ", \"frame_ring_stalls\": " + std::to_string(frameRing.stallCount())
+            + ", \"frame_ring_stall_ms\": " + std::to_string(frameRing.stallMs());
+        if (nullBackend)
+            fields += ", \"null_gl_errors\": " + std::to_string(NullGL::errorCount());
+        if (MemoryTracker::isInstalled())
+        {
+            MemoryTotals memory = MemoryTracker::totals();
+            fields += ", \"gpu_memory_mb\": " + std::to_string(memory.gpuBytes() / (1024.0 * 1024.0))
+                + ", \"tracked_cpu_mb\": " + std::to_string(memory.cpuBytes / (1024.0 * 1024.0));
+        }
+        bench.writeJson(std::cout, fields);
+        bench.release();
+    }
+    else
+    {
+        reportPrepassMode();
+        heatmap.report();
+        lodStats.report(std::cout);
+    }
+    if (memoryReport)
+        MemoryTracker::report(std::cout);
+    lodStats.release();
+    frameRing.release();
+    UploadQueue::get().release();
+    hud.release();
+    heatmap.release();
+    my_shader.release();
+    cube_shader.release();
+    backpack_shader.release();
+    depth_shader.release();
+    Shader::releaseStages();
+    if (!tracePath.empty())
+        Profiler::get().writeChromeTrace(tracePath);
+    Profiler::get().release();
+    GLCounters::closeCsv();
+    HitchDetector::close();
+    cameraRecorder.close();
+    JobSystem::get().shutdown();
+    headless.destroy();
     glfwTerminate();
     return 0;
 }
@@ -452,33 +917,179 @@ void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
-    if(glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS&& !keyPressed){
-        isOn=!isOn;
-        keyPressed = true;
+    // a playing camera path owns the camera and the flashlight
+    if (!playingPath)
+    {
+        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+            camera.ProcessKeyboard(FORWARD, deltaTime);
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+            camera.ProcessKeyboard(BACKWARD, deltaTime);
+        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+            camera.ProcessKeyboard(LEFT, deltaTime);
+        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+            camera.ProcessKeyboard(RIGHT, deltaTime);
+        if(glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS&& !keyPressed){
+            isOn=!isOn;
+            keyPressed = true;
+        }
+        if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE) {
+                keyPressed = false;
+            }
+    }
+    if(glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS&& !hKeyPressed){
+        renderRequests.hud++;
+        hKeyPressed = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE) {
-            keyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_RELEASE) {
+            hKeyPressed = false;
+        }
+    if(glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS&& !oKeyPressed){
+        renderRequests.heatmap++;
+        oKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE) {
+            oKeyPressed = false;
+        }
+    if(glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS&& !mKeyPressed){
+        renderRequests.memoryReport++;
+        mKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) {
+            mKeyPressed = false;
+        }
+    if(glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS&& !zKeyPressed){
+        renderRequests.prepass++;
+        zKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE) {
+            zKeyPressed = false;
         }
     
     
         
 }
 
+// applies the key presses processInput() queued for the renderer, on the thread that renders
+// ---------------------------------------------------------------------------------------------------------
+void applyRenderRequests()
+{
+    for (int n = renderRequests.hud.exchange(0); n > 0; n--)
+        hud.toggle();
+    for (int n = renderRequests.heatmap.exchange(0); n > 0; n--)
+        heatmap.cycle();
+    for (int n = renderRequests.prepass.exchange(0); n > 0; n--)
+    {
+        reportPrepassMode();
+        zPrepass = !zPrepass;
+    }
+    for (int n = renderRequests.memoryReport.exchange(0); n > 0; n--)
+        MemoryTracker::report(std::cout);
+}
+
+// prints the average frame time and shaded samples since the pre-pass was last toggled and starts over
+// ---------------------------------------------------------------------------------------------------------
+void reportPrepassMode()
+{
+    if (modeFrames > 0)
+    {
+        std::cout << "z-prepass " << (zPrepass ? "on" : "off") << ": "
+                  << modeFrameTime * 1000.0 / modeFrames << " ms/frame, "
+                  << modeSamples / modeFrames << " samples shaded/frame over "
+                  << modeFrames << " frames" << std::endl;
+    }
+    modeFrameTime = 0.0;
+    modeSamples = 0;
+    modeFrames = 0;
+}
+
+// points the scene shaders' uniform blocks at their binding points
+// ---------------------------------------------------------------------------------------------------------
+void bindUniformBlocks(const Shader &shader)
+{
+    shader.setBlockBinding(UNIFORM_BLOCK_NAMES[CAMERA_BLOCK], CAMERA_BLOCK);
+    shader.setBlockBinding(UNIFORM_BLOCK_NAMES[LIGHTS_BLOCK], LIGHTS_BLOCK);
+    shader.setBlockBinding(UNIFORM_BLOCK_NAMES[DRAW_BLOCK], DRAW_BLOCK);
+}
+
+// fills the frame's Camera and Lights blocks: the directional light, the flashlight (parked under
+// the ground while it's off) and the scene's point lights
+// ---------------------------------------------------------------------------------------------------------
+void writeFrameBlocks(const FrameBlocks &blocks, const glm::mat4 &view, const glm::mat4 &projection, const Camera &frameCamera,
+                      bool flashlight, const std::vector<PointLight> &pointLights)
+{
+    CameraBlock cameraBlock = {};
+    cameraBlock.view = view;
+    cameraBlock.projection = projection;
+    cameraBlock.viewPos = frameCamera.Position;
+    blocks.camera.write(0, cameraBlock);
+
+    LightsBlock lights = {};
+    lights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    lights.dirLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+    lights.dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+    lights.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+    lights.spotLight.position = flashlight ? frameCamera.Position : glm::vec3(0.0f, -20.0f, 0.0f);
+    lights.spotLight.direction = frameCamera.Front;
+    lights.spotLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+    lights.spotLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+    lights.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    lights.spotLight.constant = 1.0f;
+    lights.spotLight.linear = 0.09f;
+    lights.spotLight.quadratic = 0.032f;
+    lights.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    lights.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+    lights.setPointLights(pointLights);
+    blocks.lights.write(0, lights);
+}
+
+// the Draw block of a recorded draw
+// ---------------------------------------------------------------------------------------------------------
+DrawBlock drawBlockFor(const DrawCommand &draw)
+{
+    DrawBlock block = {};
+    block.model = draw.model;
+    block.bakedAmbient = draw.bakedAmbient;
+    block.lightingLod = draw.lightingLod;
+    block.nearestPointLight = draw.nearestPointLight;
+    return block;
+}
+
+// replays a capture into the benchmark target as fast as the driver allows and prints the timings
+// ---------------------------------------------------------------------------------------------------------
+int runReplay(const std::string &path, Benchmark &bench)
+{
+    GLReplay replay;
+    if (!replay.load(path) || !bench.createTarget(SCR_WIDTH, SCR_HEIGHT))
+        return -1;
+    bool more = true;
+    while (more)
+    {
+        bench.beginFrame();
+        more = replay.playFrame(bench.target());
+        GLCounters::endFrame();
+        bench.endFrame(0, GLCounters::lastFrame().drawCalls);
+    }
+    if (replay.failed())
+    {
+        bench.release();
+        return -1;
+    }
+    bench.writeJson(std::cout, "\"replay\": \"" + path + "\"");
+    bench.release();
+    return 0;
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    // the render loop sets the viewport, the context may be current on another thread
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
+    if (playingPath)
+        return;
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
 
@@ -501,16 +1112,31 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    if (playingPath)
+        return;
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
 unsigned int loadTexture(char const * path)
 {
+    PROFILE_SCOPE_DETAIL("loadTexture", path);
+    HITCH_SCOPE("texture load", path);
+    MEMORY_TAG("texture", path);
+    // decode and mipmaps are split out below, the rest is upload
+    LOAD_PHASE(LOAD_GPU_UPLOAD, path);
+    if (UploadQueue::get().isRunning())
+        return UploadQueue::get().loadTexture(path);
     unsigned int textureID;
     glGenTextures(1, &textureID);
     
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char *data;
+    {
+        LOAD_PHASE(LOAD_IMAGE_DECODE);
+        if (LoadReport::isEnabled())
+            LoadReport::addBytesRead(path, LoadReport::fileSize(path));
+        data = stbi_load(path, &width, &height, &nrComponents, 0);
+    }
     if (data)
     {
         GLenum format;
@@ -523,7 +1149,11 @@ unsigned int loadTexture(char const * path)
 
         glBindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        LoadReport::addBytesUploaded(path, (uint64_t)width * height * nrComponents);
+        {
+            LOAD_PHASE(LOAD_MIPMAPS);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
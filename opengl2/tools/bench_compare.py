@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+#
+#  bench_compare.py
+#  opengl2
+#
+#  Compares two sets of --bench JSON reports (e.g. a stored baseline against a new build) metric
+#  by metric, tests whether each difference is statistically significant and flags regressions.
+#
+#  usage: tools/bench_compare.py baseline candidate [--threshold 5] [--alpha 0.05]
+#
+#  baseline and candidate are each a JSON file or a directory of them (repeated runs of the same
+#  build). Every metric is one number per run, compared with a Mann-Whitney U test across runs:
+#  frame time p50/p95/p99/mean come from each run's own frames, the rest (load time, memory, draw
+#  calls, GPU and submit time) straight from its report. Frames within a run are autocorrelated,
+#  so they are never tested as independent samples. A metric needs at least 5 runs on each side to
+#  be tested, fewer can't reach p < 0.05; its change is still shown but never flagged.
+#
+#  A metric regresses when it got worse by more than --threshold percent and the difference is
+#  significant at --alpha. The exit status is 1 if anything regressed, so CI can gate on it.
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+
+# fewest runs per side for which the rank test on per-run numbers can become significant
+MIN_RUNS = 5
+
+# name, how to read it from a report, True if larger is better
+RUN_METRICS = (
+    ("frame_time_ms p50", lambda r: percentile(r["frame_times_ms"], 50), False),
+    ("frame_time_ms p95", lambda r: percentile(r["frame_times_ms"], 95), False),
+    ("frame_time_ms p99", lambda r: percentile(r["frame_times_ms"], 99), False),
+    ("frame_time_ms mean", lambda r: mean(r["frame_times_ms"]), False),
+    ("gpu_ms p50", lambda r: r["gpu_ms"]["p50"], False),
+    ("cpu_submit_ms p50", lambda r: r["cpu_submit_ms"]["p50"], False),
+    ("load_time_ms", lambda r: r["load_time_ms"], False),
+    ("peak_rss_mb", lambda r: r["peak_rss_mb"], False),
+    ("draw_calls_per_frame", lambda r: r["draw_calls_per_frame"], False),
+)
+
+
+def load_reports(path):
+    files = sorted(glob.glob(os.path.join(path, "*.json"))) if os.path.isdir(path) else [path]
+    reports = []
+    for name in files:
+        with open(name) as f:
+            text = f.read()
+        # opengl2 may print log lines before the report
+        start = text.rfind("\n{")
+        reports.append(json.loads(text[start + 1 if start >= 0 else text.find("{"):]))
+    if not reports:
+        sys.exit("bench_compare: no reports in %s" % path)
+    return reports
+
+
+def percentile(values, p):
+    # nearest rank, like Benchmark.h
+    ordered = sorted(values)
+    rank = max(1, min(len(ordered), int(math.ceil(p / 100.0 * len(ordered)))))
+    return ordered[rank - 1]
+
+
+def mean(values):
+    return sum(values) / len(values)
+
+
+def mann_whitney(a, b):
+    """two-sided p-value of the Mann-Whitney U test, normal approximation with tie correction"""
+    n1, n2 = len(a), len(b)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+    pooled = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1.0
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    r1 = sum(rank for rank, (_, side) in zip(ranks, pooled) if side == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1))) if n > 1 else 0.0
+    if variance <= 0.0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+    return min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2.0)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare opengl2 --bench reports with significance tests")
+    parser.add_argument("baseline", help="JSON report or directory of reports")
+    parser.add_argument("candidate", help="JSON report or directory of reports")
+    parser.add_argument("--threshold", type=float, default=5.0, help="regression threshold in percent (default 5)")
+    parser.add_argument("--alpha", type=float, default=0.05, help="significance level (default 0.05)")
+    options = parser.parse_args()
+
+    base = load_reports(options.baseline)
+    cand = load_reports(options.candidate)
+
+    for key in ("renderer", "objects", "z_prepass", "backend", "camera_path", "threads"):
+        values = set(str(r.get(key)) for r in base + cand)
+        if len(values) > 1:
+            print("warning: runs differ in %s: %s" % (key, ", ".join(sorted(values))))
+
+    rows = []
+    for name, read, higher_is_better in RUN_METRICS:
+        try:
+            a = [read(r) for r in base]
+            b = [read(r) for r in cand]
+        except (KeyError, IndexError, ZeroDivisionError):
+            # missing field, or a run without frames
+            continue
+        p = mann_whitney(a, b) if len(a) >= MIN_RUNS and len(b) >= MIN_RUNS else None
+        rows.append((name, mean(a), mean(b), p, higher_is_better))
+
+    print("%d baseline run(s), %d candidate run(s), threshold %.1f%%, alpha %.3f\n"
+          % (len(base), len(cand), options.threshold, options.alpha))
+    print("%-22s %12s %12s %9s %9s  %s" % ("metric", "baseline", "candidate", "change", "p", "verdict"))
+    regressions = 0
+    for name, a, b, p, higher_is_better in rows:
+        change = (b - a) / a * 100.0 if a else (0.0 if b == a else float("inf"))
+        worse = -change if higher_is_better else change
+        significant = p is not None and p < options.alpha
+        if significant and worse > options.threshold:
+            verdict = "REGRESSION"
+            regressions += 1
+        elif significant and worse < -options.threshold:
+            verdict = "improved"
+        elif significant:
+            verdict = "changed, within threshold"
+        elif p is None:
+            verdict = "not tested (< %d runs)" % MIN_RUNS
+        else:
+            verdict = "no significant change"
+        print("%-22s %12.4f %12.4f %+8.2f%% %9s  %s"
+              % (name, a, b, change, "-" if p is None else "%.4f" % p, verdict))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+#  bench_sweep.py
+#  opengl2
+#
+#  Runs the headless benchmark (--bench) over a range of stress-scene sizes and prints how frame
+#  time and memory scale. Each sweep varies one parameter and keeps the others at the hand-made
+#  scene's values (13 cubes, 4 point lights, 1 backpack) unless they are fixed with --set.
+#
+#  usage: tools/bench_sweep.py path/to/opengl2 [--sweep cubes=10,100,1000] [--set lights=8]
+#                              [--csv sweep.csv] [-- extra opengl2 args, e.g. --null --frames 300]
+#
+#  Without --sweep it sweeps cubes, lights and models over their default ranges. The binary runs
+#  from the directory above tools/, where its shaders and textures live.
+
+import argparse
+import csv
+import json
+import os
+import subprocess
+import sys
+
+DEFAULT_SWEEPS = {
+    "cubes": [10, 100, 1000, 5000, 20000],
+    "lights": [0, 1, 4, 8, 16, 32],
+    "models": [0, 1, 4, 16, 64],
+}
+PARAMETERS = ("cubes", "lights", "models", "seed")
+COLUMNS = ("p50_ms", "p95_ms", "p99_ms", "gpu_p50_ms", "cpu_submit_p50_ms", "peak_rss_mb")
+
+
+def parse_assignment(text, allow_list):
+    key, sep, value = text.partition("=")
+    if not sep or key not in PARAMETERS:
+        raise argparse.ArgumentTypeError("expected one of %s=value, got %r" % ("/".join(PARAMETERS), text))
+    values = [int(v) for v in value.split(",") if v]
+    if not values or (not allow_list and len(values) != 1):
+        raise argparse.ArgumentTypeError("bad value in %r" % text)
+    return key, values
+
+
+def run(binary, workdir, params, extra):
+    args = [binary, "--bench"]
+    for key, value in params.items():
+        args += ["--" + key, str(value)]
+    args += extra
+    result = subprocess.run(args, cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    # the JSON report is the last thing on stdout, anything before it is log output
+    start = result.stdout.rfind("\n{")
+    start = start + 1 if start >= 0 else result.stdout.find("{")
+    if result.returncode != 0 or start < 0:
+        sys.stderr.write("bench_sweep: %s failed (%d)\n%s" % (" ".join(args), result.returncode, result.stderr))
+        return None
+    report = json.loads(result.stdout[start:])
+    return {
+        "p50_ms": report["frame_time_ms"]["p50"],
+        "p95_ms": report["frame_time_ms"]["p95"],
+        "p99_ms": report["frame_time_ms"]["p99"],
+        "gpu_p50_ms": report["gpu_ms"]["p50"],
+        "cpu_submit_p50_ms": report["cpu_submit_ms"]["p50"],
+        "peak_rss_mb": report.get("peak_rss_mb", 0.0),
+    }
+
+
+def print_curve(name, rows):
+    print("\n%s sweep" % name)
+    print("%10s" % name + "".join("%20s" % column for column in COLUMNS))
+    for value, stats in rows:
+        print("%10d" % value + "".join("%20.3f" % stats[column] for column in COLUMNS))
+    # frame time growth per unit, between the first and last point, as a rough slope of the curve
+    if len(rows) >= 2 and rows[-1][0] != rows[0][0]:
+        slope = (rows[-1][1]["p50_ms"] - rows[0][1]["p50_ms"]) / (rows[-1][0] - rows[0][0])
+        memory = (rows[-1][1]["peak_rss_mb"] - rows[0][1]["peak_rss_mb"]) / (rows[-1][0] - rows[0][0])
+        print("  ~%.5f ms and %.4f MB per additional %s" % (slope, memory, name.rstrip("s")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sweep stress-scene sizes through opengl2 --bench")
+    parser.add_argument("binary", help="path to the opengl2 executable")
+    parser.add_argument("--sweep", action="append", default=[], type=lambda t: parse_assignment(t, True),
+                        help="parameter=v1,v2,... to sweep (repeatable)")
+    parser.add_argument("--set", action="append", default=[], type=lambda t: parse_assignment(t, False),
+                        help="parameter=value held fixed during every sweep (repeatable)")
+    parser.add_argument("--csv", help="also write every measurement to this CSV file")
+    argv = sys.argv[1:]
+    extra = argv[argv.index("--") + 1:] if "--" in argv else []
+    options = parser.parse_args(argv[:len(argv) - len(extra) - (1 if "--" in argv else 0)])
+
+    binary = os.path.abspath(options.binary)
+    workdir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    sweeps = dict(options.sweep) if options.sweep else DEFAULT_SWEEPS
+    fixed = {key: values[0] for key, values in options.set}
+
+    records = []
+    for name, values in sweeps.items():
+        rows = []
+        for value in values:
+            params = dict(fixed)
+            params[name] = value
+            sys.stderr.write("bench_sweep: %s\n" % " ".join("%s=%d" % item for item in sorted(params.items())))
+            stats = run(binary, workdir, params, extra)
+            if stats is None:
+                continue
+            rows.append((value, stats))
+            records.append(dict(sweep=name, value=value, **stats))
+        print_curve(name, rows)
+
+    if options.csv:
+        with open(options.csv, "w", newline="") as out:
+            writer = csv.DictWriter(out, fieldnames=("sweep", "value") + COLUMNS)
+            writer.writeheader()
+            writer.writerows(records)
+    return 0 if records else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,99 @@
+#!/bin/sh
+#
+#  optimize_shaders.sh
+#  opengl2
+#
+#  Validates every shader stage file (*_v, *_f, *v_shader, *f_shader), runs it through glslang -> spirv-opt -> spirv-cross and installs
+#  the result into optimized/, which Shader prefers over the hand-written file as long as it is newer. A shader is only
+#  replaced when the optimized copy validates and exposes the same active uniforms, otherwise the
+#  validated original is installed so the app never loads something that behaves differently.
+#
+#  usage: tools/optimize_shaders.sh [shader dir]   (defaults to the directory above tools/)
+#
+#  Needs glslangValidator, spirv-opt, spirv-cross and spirv-dis (Vulkan SDK or Homebrew). Without
+#  them optimized/ is removed, so an older run can't shadow edits to the sources.
+#  Prints per-shader SPIR-V instruction and texture fetch counts before/after optimization.
+
+set -u
+
+SRC_DIR=${1:-"$(cd "$(dirname "$0")/.." && pwd)"}
+OUT_DIR="$SRC_DIR/optimized"
+
+for tool in glslangValidator spirv-opt spirv-cross spirv-dis; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        echo "optimize_shaders: $tool not found, skipping shader optimization"
+        rm -rf "$OUT_DIR"
+        exit 0
+    fi
+done
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+mkdir -p "$OUT_DIR"
+
+# stage from our naming convention: *_v / *v_shader are vertex shaders, *_f / *f_shader fragment
+stage_of() {
+    case "$1" in
+        *_v|v_shader|*_v_shader) echo vert ;;
+        *_f|f_shader|*_f_shader) echo frag ;;
+    esac
+}
+
+# "<instructions> <texture fetches>" of a SPIR-V module
+count_ops() {
+    spirv-dis "$1" | awk '
+        /^ *(%[A-Za-z0-9_]+ = )?Op/ { n++ }
+        /OpImage(Sparse)?(Sample|Fetch|Gather)/ { t++ }
+        END { printf "%d %d", n, t }'
+}
+
+# active uniforms as reported by glslang reflection, used to make sure the interface didn't change
+uniforms_of() {
+    glslangValidator -q -S "$2" "$1" 2>/dev/null | awk '
+        /^Uniform reflection:/ { on = 1; next }
+        /^[A-Za-z ]+reflection:/ { on = 0 }
+        on && NF { split($0, a, ":"); print a[1] }' | sort
+}
+
+status=0
+printf '%-16s %5s  %12s  %12s  %s\n' shader stage "instr b/a" "fetch b/a" result
+for src in "$SRC_DIR"/*_v "$SRC_DIR"/*_f "$SRC_DIR"/*v_shader "$SRC_DIR"/*f_shader; do
+    [ -f "$src" ] || continue
+    name=$(basename "$src")
+    stage=$(stage_of "$name")
+
+    if ! glslangValidator -S "$stage" "$src" >"$WORK/$name.log" 2>&1; then
+        echo "optimize_shaders: $name failed validation"
+        cat "$WORK/$name.log"
+        rm -f "$OUT_DIR/$name"
+        status=1
+        continue
+    fi
+
+    result=installed-original
+    before="- -"
+    after="- -"
+    if glslangValidator -G --auto-map-locations --auto-map-bindings -S "$stage" -o "$WORK/$name.spv" "$src" >/dev/null 2>&1 \
+        && spirv-opt -O "$WORK/$name.spv" -o "$WORK/$name.opt.spv" \
+        && spirv-cross --version 330 --no-es --no-420pack-extension "$WORK/$name.opt.spv" --output "$WORK/$name.glsl" \
+        && glslangValidator -S "$stage" "$WORK/$name.glsl" >/dev/null 2>&1
+    then
+        before=$(count_ops "$WORK/$name.spv")
+        after=$(count_ops "$WORK/$name.opt.spv")
+        if [ "$(uniforms_of "$src" "$stage")" = "$(uniforms_of "$WORK/$name.glsl" "$stage")" ]; then
+            cp "$WORK/$name.glsl" "$OUT_DIR/$name"
+            result=installed-optimized
+        else
+            cp "$src" "$OUT_DIR/$name"
+            result="installed-original (uniform interface changed)"
+        fi
+    else
+        cp "$src" "$OUT_DIR/$name"
+        result="installed-original (cross-compile failed)"
+    fi
+    set -- $before
+    b_instr=$1; b_fetch=$2
+    set -- $after
+    printf '%-16s %5s  %5s/%-6s  %5s/%-6s  %s\n' "$name" "$stage" "$b_instr" "$1" "$b_fetch" "$2" "$result"
+done
+exit $status